@@ -0,0 +1,533 @@
+#include "actor.h"
+#include "interpreter.h"
+#include "governor.h"
+#include "output.h"
+#include "talloc.h"
+#include "task.h"
+#include "linkedlist.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+// Actors run deep recursions like the main program does.
+#define ACTOR_STACK_SIZE ((size_t)256 << 20)
+#define BLOCK_SIZE 4096
+
+// Memory a message is copied into on send, freed once it is received.
+typedef struct Block {
+    struct Block *next;
+    size_t used;
+    size_t size;
+    _Alignas(8) char bytes[];
+} Block;
+
+// A message on its way, linked into the receiver's mailbox.
+typedef struct Envelope {
+    struct Envelope *next;
+    Value *message;
+    Block *blocks;
+} Envelope;
+
+// The mailbox is an intrusive queue of envelopes with many producers and one
+// consumer (Vyukov's): senders swap themselves in at head and then link the
+// envelope they replaced to theirs, and the actor pops from tail. stub keeps
+// the queue from ever being empty, so neither end needs a lock. head and tail
+// are on separate cache lines, being written by different threads.
+struct Actor {
+    Envelope *head;
+    Envelope stub;
+    _Alignas(64) Envelope *tail;
+    // for sleeping on an empty mailbox
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    int sleeping;
+    int finished;
+    // whether the actor counts as busy while it isn't sleeping; the main
+    // program doesn't, since it is what waits for the others
+    int counted;
+};
+
+// actors that are neither ended nor asleep
+static long busy;
+static pthread_mutex_t idleLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t idle = PTHREAD_COND_INITIALIZER;
+
+static __thread Actor *current;
+
+// COPYING
+
+enum { VALUE_OBJECT, FRAME_OBJECT };
+
+typedef struct {
+    void *object;
+    int kind;
+} Entry;
+
+typedef struct {
+    void *from;
+    void *to;
+} Forward;
+
+// The state of copying a graph of values: copies made so far, copies whose
+// fields still point at the originals, and where the copies go.
+typedef struct Copier {
+    void *(*allocate)(struct Copier *copier, size_t size);
+    // refuse anything that isn't plain data, as messages are
+    int dataOnly;
+    int refused;
+    Block *blocks;
+    Forward *forwards;
+    size_t forwardCapacity;
+    size_t forwardCount;
+    Entry *pending;
+    size_t pendingCapacity;
+    size_t pendingCount;
+} Copier;
+
+static void *allocateInRegion(Copier *copier, size_t size) {
+    return talloc(size);
+}
+
+static void *allocateInBlocks(Copier *copier, size_t size) {
+    size = (size + 7) & ~(size_t)7;
+    Block *block = copier->blocks;
+    if (block == NULL || block->used + size > block->size) {
+        size_t capacity = size > BLOCK_SIZE ? size : BLOCK_SIZE;
+        block = malloc(sizeof(Block) + capacity);
+        block->next = copier->blocks;
+        block->used = 0;
+        block->size = capacity;
+        copier->blocks = block;
+    }
+    void *pointer = block->bytes + block->used;
+    block->used += size;
+    return pointer;
+}
+
+static void freeBlocks(Block *block) {
+    while (block != NULL) {
+        Block *next = block->next;
+        free(block);
+        block = next;
+    }
+}
+
+static size_t slotFor(void *object, size_t capacity) {
+    uint64_t hash = (uintptr_t)object * 0x9E3779B97F4A7C15u;
+    return (hash ^ (hash >> 32)) & (capacity - 1);
+}
+
+static void *lookUpForward(Copier *copier, void *from) {
+    if (copier->forwardCapacity == 0) {
+        return NULL;
+    }
+    for (size_t slot = slotFor(from, copier->forwardCapacity); copier->forwards[slot].from != NULL;
+         slot = (slot + 1) & (copier->forwardCapacity - 1)) {
+        if (copier->forwards[slot].from == from) {
+            return copier->forwards[slot].to;
+        }
+    }
+    return NULL;
+}
+
+static void addForward(Copier *copier, void *from, void *to) {
+    if ((copier->forwardCount + 1) * 2 > copier->forwardCapacity) {
+        Forward *old = copier->forwards;
+        size_t oldCapacity = copier->forwardCapacity;
+        copier->forwardCapacity = oldCapacity ? oldCapacity * 2 : 256;
+        copier->forwards = calloc(copier->forwardCapacity, sizeof(Forward));
+        copier->forwardCount = 0;
+        for (size_t i = 0; i < oldCapacity; i++) {
+            if (old[i].from != NULL) {
+                addForward(copier, old[i].from, old[i].to);
+            }
+        }
+        free(old);
+    }
+    size_t slot = slotFor(from, copier->forwardCapacity);
+    while (copier->forwards[slot].from != NULL) {
+        slot = (slot + 1) & (copier->forwardCapacity - 1);
+    }
+    copier->forwards[slot].from = from;
+    copier->forwards[slot].to = to;
+    copier->forwardCount++;
+}
+
+static char *copyString(Copier *copier, char *s) {
+    if (s == NULL) {
+        return NULL;
+    }
+    size_t size = strlen(s) + 1;
+    char *copy = copier->allocate(copier, size);
+    memcpy(copy, s, size);
+    return copy;
+}
+
+// whether value is a number, string, symbol, boolean or the empty list
+static int isAtom(Value *value) {
+    switch (value->type) {
+        case INT_TYPE:
+        case DOUBLE_TYPE:
+        case STR_TYPE:
+        case SYMBOL_TYPE:
+        case BOOL_TYPE:
+        case NULL_TYPE:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// The copy of object, made (and queued for its fields to be copied) the first
+// time it is asked for.
+static void *copyObject(Copier *copier, void *object, int kind) {
+    if (object == NULL) {
+        return NULL;
+    }
+    void *copy = lookUpForward(copier, object);
+    if (copy != NULL) {
+        return copy;
+    }
+    size_t size = kind == FRAME_OBJECT ? sizeof(Frame) : valueSize(object);
+    copy = copier->allocate(copier, size);
+    if (kind == VALUE_OBJECT && isAtom(object)) {
+        // an atom of a datum file ends after the bytes its fields use
+        memset(copy, 0, size);
+        memcpy(copy, object, ATOM_SIZE);
+    } else {
+        memcpy(copy, object, size);
+    }
+    addForward(copier, object, copy);
+
+    if (copier->pendingCount == copier->pendingCapacity) {
+        copier->pendingCapacity = copier->pendingCapacity ? copier->pendingCapacity * 2 : 256;
+        copier->pending = realloc(copier->pending, copier->pendingCapacity * sizeof(Entry));
+    }
+    copier->pending[copier->pendingCount].object = copy;
+    copier->pending[copier->pendingCount].kind = kind;
+    copier->pendingCount++;
+    return copy;
+}
+
+// Point the fields of a copy at copies of what they point at. Primitives,
+// ports and actors are shared rather than copied.
+static void copyFields(Copier *copier, void *object, int kind) {
+    if (kind == FRAME_OBJECT) {
+        Frame *frame = object;
+        frame->bindings = copyObject(copier, frame->bindings, VALUE_OBJECT);
+        frame->parent = copyObject(copier, frame->parent, FRAME_OBJECT);
+        return;
+    }
+
+    Value *value = object;
+    switch (value->type) {
+        case INT_TYPE:
+        case DOUBLE_TYPE:
+        case NULL_TYPE:
+        case ACTOR_TYPE:
+            break;
+        case STR_TYPE:
+        case SYMBOL_TYPE:
+        case BOOL_TYPE:
+            value->s = copyString(copier, value->s);
+            break;
+        case CONS_TYPE:
+            value->c.car = copyObject(copier, value->c.car, VALUE_OBJECT);
+            value->c.cdr = copyObject(copier, value->c.cdr, VALUE_OBJECT);
+            break;
+        case F64VECTOR_TYPE: {
+            double *elements = copier->allocate(copier, value->fv.length * sizeof(double));
+            memcpy(elements, value->fv.elements, value->fv.length * sizeof(double));
+            value->fv.elements = elements;
+            break;
+        }
+        default:
+            if (copier->dataOnly) {
+                copier->refused = 1;
+                return;
+            }
+            switch (value->type) {
+                case OPEN_TYPE:
+                case CLOSE_TYPE:
+                    value->s = copyString(copier, value->s);
+                    break;
+                case CLOSURE_TYPE:
+                    value->cl.paramNames = copyObject(copier, value->cl.paramNames, VALUE_OBJECT);
+                    value->cl.functionCode = copyObject(copier, value->cl.functionCode, VALUE_OBJECT);
+                    value->cl.frame = copyObject(copier, value->cl.frame, FRAME_OBJECT);
+                    // the copy is compiled afresh once it gets hot
+                    closureInfo(value)->calls = 0;
+                    closureInfo(value)->native = NULL;
+                    break;
+                case PROMISE_TYPE:
+                    value->pr.value = copyObject(copier, value->pr.value, VALUE_OBJECT);
+                    value->pr.code = copyObject(copier, value->pr.code, VALUE_OBJECT);
+                    value->pr.frame = copyObject(copier, value->pr.frame, FRAME_OBJECT);
+                    break;
+                case MACRO_TYPE:
+                    value->mc.literals = copyObject(copier, value->mc.literals, VALUE_OBJECT);
+                    value->mc.rules = copyObject(copier, value->mc.rules, VALUE_OBJECT);
+                    break;
+                case UNSPECIFIED_TYPE:
+                    value->p = copyObject(copier, value->p, VALUE_OBJECT);
+                    break;
+                default:
+                    break;
+            }
+            break;
+    }
+}
+
+// Copy value and everything reachable from it with copier, which is left
+// ready for another copy. Returns NULL if copier refused something.
+static Value *copyGraph(Copier *copier, Value *value) {
+    Value *copy = copyObject(copier, value, VALUE_OBJECT);
+    while (copier->pendingCount > 0 && !copier->refused) {
+        Entry next = copier->pending[--copier->pendingCount];
+        copyFields(copier, next.object, next.kind);
+    }
+    copier->pendingCount = 0;
+    free(copier->forwards);
+    free(copier->pending);
+    copier->forwards = NULL;
+    copier->forwardCapacity = copier->forwardCount = 0;
+    copier->pending = NULL;
+    copier->pendingCapacity = 0;
+    return copier->refused ? NULL : copy;
+}
+
+// MAILBOXES
+
+static Actor *makeActor(int counted) {
+    Actor *actor = aligned_alloc(_Alignof(Actor), sizeof(Actor));
+    memset(actor, 0, sizeof(Actor));
+    actor->head = &actor->stub;
+    actor->tail = &actor->stub;
+    pthread_mutex_init(&actor->lock, NULL);
+    pthread_cond_init(&actor->wake, NULL);
+    actor->counted = counted;
+    return actor;
+}
+
+// The actor of the calling thread.
+Actor *currentActor() {
+    if (current == NULL) {
+        // the main program's, made when it is first needed
+        current = makeActor(0);
+    }
+    return current;
+}
+
+static void push(Actor *actor, Envelope *envelope) {
+    __atomic_store_n(&envelope->next, NULL, __ATOMIC_RELAXED);
+    Envelope *previous = __atomic_exchange_n(&actor->head, envelope, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&previous->next, envelope, __ATOMIC_RELEASE);
+}
+
+// the next envelope in actor's mailbox, or NULL if there is none or the one
+// there is still being linked in
+static Envelope *pop(Actor *actor) {
+    Envelope *tail = actor->tail;
+    Envelope *next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+    if (tail == &actor->stub) {
+        if (next == NULL) {
+            return NULL;
+        }
+        actor->tail = next;
+        tail = next;
+        next = __atomic_load_n(&next->next, __ATOMIC_ACQUIRE);
+    }
+    if (next != NULL) {
+        actor->tail = next;
+        return tail;
+    }
+    if (tail != __atomic_load_n(&actor->head, __ATOMIC_SEQ_CST)) {
+        return NULL;
+    }
+    push(actor, &actor->stub);
+    next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+    if (next != NULL) {
+        actor->tail = next;
+        return tail;
+    }
+    return NULL;
+}
+
+// whether nothing has been pushed onto actor's mailbox that isn't popped yet
+static int isEmpty(Actor *actor) {
+    return actor->tail == &actor->stub &&
+           __atomic_load_n(&actor->head, __ATOMIC_SEQ_CST) == &actor->stub;
+}
+
+static void becomeIdle() {
+    if (__atomic_sub_fetch(&busy, 1, __ATOMIC_SEQ_CST) == 0) {
+        pthread_mutex_lock(&idleLock);
+        pthread_cond_broadcast(&idle);
+        pthread_mutex_unlock(&idleLock);
+    }
+}
+
+// Send a copy of message to actor.
+int sendMessage(Actor *actor, Value *message) {
+    Copier copier = {allocateInBlocks, 1};
+    Envelope *envelope = allocateInBlocks(&copier, sizeof(Envelope));
+    envelope->message = copyGraph(&copier, message);
+    envelope->blocks = copier.blocks;
+    if (envelope->message == NULL) {
+        freeBlocks(envelope->blocks);
+        return 2;
+    }
+    if (__atomic_load_n(&actor->finished, __ATOMIC_ACQUIRE)) {
+        freeBlocks(envelope->blocks);
+        return 0;
+    }
+    push(actor, envelope);
+
+    // the receiver announces it is going to sleep before looking at its
+    // mailbox one last time, so either it sees the envelope or this sees it
+    if (__atomic_load_n(&actor->sleeping, __ATOMIC_SEQ_CST)) {
+        pthread_mutex_lock(&actor->lock);
+        if (actor->sleeping) {
+            // counted as busy again before the sender can go idle itself
+            __atomic_store_n(&actor->sleeping, 0, __ATOMIC_SEQ_CST);
+            if (actor->counted) {
+                __atomic_add_fetch(&busy, 1, __ATOMIC_SEQ_CST);
+            }
+            pthread_cond_signal(&actor->wake);
+        }
+        pthread_mutex_unlock(&actor->lock);
+    }
+    return 0;
+}
+
+// The next message sent to the calling thread's actor.
+Value *receiveMessage() {
+    Actor *actor = currentActor();
+    Envelope *envelope;
+    while ((envelope = pop(actor)) == NULL) {
+        if (!isEmpty(actor)) {
+            // a sender is halfway through linking its envelope in
+            sched_yield();
+            continue;
+        }
+        // what was printed so far goes out before waiting
+        flushOutput();
+        pthread_mutex_lock(&actor->lock);
+        __atomic_store_n(&actor->sleeping, 1, __ATOMIC_SEQ_CST);
+        if (!isEmpty(actor)) {
+            __atomic_store_n(&actor->sleeping, 0, __ATOMIC_SEQ_CST);
+        } else {
+            if (actor->counted) {
+                becomeIdle();
+            }
+            while (actor->sleeping) {
+                pthread_cond_wait(&actor->wake, &actor->lock);
+            }
+        }
+        pthread_mutex_unlock(&actor->lock);
+    }
+
+    Copier copier = {allocateInRegion, 0};
+    Value *message = copyGraph(&copier, envelope->message);
+    freeBlocks(envelope->blocks);
+    return message;
+}
+
+// Wait until every actor has ended or is waiting with nothing to come.
+void waitForActors() {
+    pthread_mutex_lock(&idleLock);
+    while (__atomic_load_n(&busy, __ATOMIC_SEQ_CST) > 0) {
+        pthread_cond_wait(&idle, &idleLock);
+    }
+    pthread_mutex_unlock(&idleLock);
+}
+
+// SPAWNING
+
+// What a new actor's thread starts from. It lives on the spawning thread's
+// stack, which waits until the thunk has been copied out.
+typedef struct Start {
+    Actor *actor;
+    Value *thunk;
+    Limits limits;
+    sem_t copied;
+} Start;
+
+static void *runActor(void *data) {
+    Start *start = data;
+    Actor *actor = start->actor;
+    Limits limits = start->limits;
+    current = actor;
+    Region *region = newRegion();
+    useRegion(region);
+    Copier copier = {allocateInRegion, 0};
+    Value *thunk = copyGraph(&copier, start->thunk);
+    sem_post(&start->copied);
+
+    // files are loaded into the copy of the global frame
+    Frame *top = thunk->cl.frame;
+    while (top->parent != NULL) {
+        top = top->parent;
+    }
+    setTopFrame(top);
+    governThread(&limits);
+
+    jmp_buf recovery;
+    if (setjmp(recovery) == 0) {
+        setRecovery(&recovery);
+        applyArray(thunk, 0, NULL);
+        waitForTasks();
+    }
+    setRecovery(NULL);
+    finishOutput();
+
+    __atomic_store_n(&actor->finished, 1, __ATOMIC_RELEASE);
+    Envelope *envelope;
+    while ((envelope = pop(actor)) != NULL) {
+        freeBlocks(envelope->blocks);
+    }
+    freeRegion(region);
+    becomeIdle();
+    return NULL;
+}
+
+// Start an actor that calls thunk.
+Actor *spawnActor(Value *thunk) {
+    shareHeap();
+    Start start;
+    start.actor = makeActor(1);
+    start.thunk = thunk;
+    start.limits = remainingLimits();
+    sem_init(&start.copied, 0, 0);
+
+    __atomic_add_fetch(&busy, 1, __ATOMIC_SEQ_CST);
+    pthread_attr_t attributes;
+    pthread_attr_init(&attributes);
+    pthread_attr_setstacksize(&attributes, ACTOR_STACK_SIZE);
+    pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+    // the timer signal is for the main thread's native code, so the new
+    // thread starts with it blocked
+    sigset_t alarm, previous;
+    sigemptyset(&alarm);
+    sigaddset(&alarm, SIGALRM);
+    pthread_sigmask(SIG_BLOCK, &alarm, &previous);
+    pthread_t thread;
+    int failed = pthread_create(&thread, &attributes, runActor, &start);
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+    pthread_attr_destroy(&attributes);
+    if (failed) {
+        becomeIdle();
+        sem_destroy(&start.copied);
+        free(start.actor);
+        return NULL;
+    }
+    while (sem_wait(&start.copied) != 0) {
+    }
+    sem_destroy(&start.copied);
+    return start.actor;
+}
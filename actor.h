@@ -0,0 +1,39 @@
+#include "value.h"
+
+#ifndef _ACTOR
+#define _ACTOR
+
+// An actor runs a thunk on an OS thread of its own, with a heap of its own:
+// it starts from a copy of everything the thunk can reach (the global frame
+// included), so actors never share mutable state. They talk by sending each
+// other messages, which are copied too: into memory of the message's own on
+// send, and out of it into the receiver's heap on receive. Each actor's
+// mailbox is a lock-free queue that any thread pushes onto and only the
+// actor pops; a lock is only taken to put an actor with an empty mailbox to
+// sleep and to wake it up again. The main program is an actor as well, as far
+// as sending to it goes.
+typedef struct Actor Actor;
+
+// Start an actor that calls thunk, a closure of no parameters. An error in the
+// actor ends it alone, after printing its message. Returns NULL if the thread
+// can't be started.
+Actor *spawnActor(Value *thunk);
+
+// Send a copy of message to actor, which may be made of numbers, strings,
+// symbols, booleans, lists, f64vectors and actors. Returns 0 on success and 2
+// if the message holds anything else. Messages to actors that have ended are
+// dropped.
+int sendMessage(Actor *actor, Value *message);
+
+// The next message sent to the calling thread's actor, copied into the
+// current region, waiting for one to come if there is none yet.
+Value *receiveMessage();
+
+// The actor of the calling thread.
+Actor *currentActor();
+
+// Wait until every actor has either ended or is waiting for a message with
+// none to come, which is when the program is done.
+void waitForActors();
+
+#endif
@@ -0,0 +1,247 @@
+#include "batch.h"
+#include "server.h"
+#include "talloc.h"
+#include "output.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+typedef enum {PENDING, RUNNING, PASSED, FAILED, UNREADABLE, CRASHED} Outcome;
+
+static char *outcomeNames[] = {"pending", "running", "ok", "error", "unreadable",
+                               "crashed"};
+
+// How one script went, filled in by the worker that ran it.
+typedef struct Result {
+    Outcome outcome;
+    double seconds;
+} Result;
+
+// Memory shared by the workers: the next script to hand out, the script each
+// worker is running (-1 if none), and the results.
+typedef struct Shared {
+    int next;
+    int running[];
+} Shared;
+
+static double now() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+static int compareNames(const void *a, const void *b) {
+    return strcmp(*(char **)a, *(char **)b);
+}
+
+// add path to the list of scripts
+static void addScript(char ***scripts, int *count, char *path) {
+    *scripts = realloc(*scripts, (*count + 1) * sizeof(char *));
+    (*scripts)[(*count)++] = strdup(path);
+}
+
+// The scripts at path, a directory or a file listing them; NULL if there is
+// no such directory or file.
+static char **findScripts(char *path, int *count) {
+    char **scripts = NULL;
+    *count = 0;
+    DIR *directory = opendir(path);
+    if (directory != NULL) {
+        struct dirent *entry;
+        while ((entry = readdir(directory)) != NULL) {
+            size_t length = strlen(entry->d_name);
+            if (length > 4 && !strcmp(entry->d_name + length - 4, ".scm")) {
+                char script[strlen(path) + length + 2];
+                sprintf(script, "%s/%s", path, entry->d_name);
+                addScript(&scripts, count, script);
+            }
+        }
+        closedir(directory);
+        qsort(scripts, *count, sizeof(char *), compareNames);
+        return scripts != NULL ? scripts : malloc(1);
+    }
+
+    FILE *list = fopen(path, "r");
+    if (list == NULL) {
+        return NULL;
+    }
+    char line[4096];
+    while (fgets(line, sizeof(line), list) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] != '\0') {
+            addScript(&scripts, count, line);
+        }
+    }
+    fclose(list);
+    return scripts != NULL ? scripts : malloc(1);
+}
+
+// where the output of script goes
+static char *outputPath(char *script, char *output) {
+    char *name = script;
+    if (output != NULL && strrchr(script, '/') != NULL) {
+        name = strrchr(script, '/') + 1;
+    }
+    char *path = malloc((output != NULL ? strlen(output) + 1 : 0) + strlen(name) + 5);
+    if (output != NULL) {
+        sprintf(path, "%s/%s.out", output, name);
+    } else {
+        sprintf(path, "%s.out", name);
+    }
+    return path;
+}
+
+// Run script, returning how it went.
+static Outcome runScript(char *script, char *output, Frame *base, Limits *limits,
+                         Region *region, int console) {
+    FILE *stream = fopen(script, "rb");
+    if (stream == NULL) {
+        return UNREADABLE;
+    }
+    fseek(stream, 0, SEEK_END);
+    long length = ftell(stream);
+    rewind(stream);
+    char *program = malloc(length + 1);
+    size_t got = fread(program, 1, length, stream);
+    fclose(stream);
+
+    char *path = outputPath(script, output);
+    int out = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    free(path);
+    if (out < 0) {
+        free(program);
+        return UNREADABLE;
+    }
+    int status = runProgram(program, got, base, limits, region, out, console);
+    close(out);
+    free(program);
+    return status == 0 ? PASSED : FAILED;
+}
+
+// The body of worker number worker: take scripts until there are none left.
+static void work(int worker, char **scripts, int count, char *output, Frame *base,
+                 Limits *limits, Shared *shared, Result *results) {
+    Region *region = newRegion();
+    int console = dup(STDOUT_FILENO);
+    for (;;) {
+        int script = __atomic_fetch_add(&shared->next, 1, __ATOMIC_SEQ_CST);
+        if (script >= count) {
+            break;
+        }
+        shared->running[worker] = script;
+        results[script].outcome = RUNNING;
+        double start = now();
+        Outcome outcome = runScript(scripts[script], output, base, limits, region,
+                                    console);
+        results[script].seconds = now() - start;
+        results[script].outcome = outcome;
+        shared->running[worker] = -1;
+    }
+    _exit(0);
+}
+
+// Start worker number worker, returning its process id.
+static pid_t startWorker(int worker, char **scripts, int count, char *output,
+                         Frame *base, Limits *limits, Shared *shared,
+                         Result *results) {
+    shared->running[worker] = -1;
+    pid_t pid = fork();
+    if (pid == 0) {
+        work(worker, scripts, count, output, base, limits, shared, results);
+    }
+    return pid;
+}
+
+// Run a batch of scripts across workers processes.
+int runBatch(char *path, char *output, int workers, Frame *base, Limits *limits) {
+    int count;
+    char **scripts = findScripts(path, &count);
+    if (scripts == NULL) {
+        fprintf(stderr, "Batch error: cannot read %s\n", path);
+        return 1;
+    }
+    if (workers < 1) {
+        workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (workers > count) {
+        workers = count > 0 ? count : 1;
+    }
+
+    // the results follow the running array, rounded up to their alignment
+    size_t resultsOffset = sizeof(Shared) + workers * sizeof(int);
+    resultsOffset = (resultsOffset + _Alignof(Result) - 1) & ~(_Alignof(Result) - 1);
+    size_t sharedSize = resultsOffset + count * sizeof(Result);
+    Shared *shared = mmap(NULL, sharedSize, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) {
+        fprintf(stderr, "Batch error: cannot share memory with the workers\n");
+        return 1;
+    }
+    Result *results = (Result *)((char *)shared + resultsOffset);
+
+    // anything still buffered would otherwise be written by every worker
+    flushOutput();
+    fflush(stdout);
+
+    double start = now();
+    pid_t pids[workers];
+    for (int i = 0; i < workers; i++) {
+        pids[i] = startWorker(i, scripts, count, output, base, limits, shared, results);
+    }
+
+    // A worker that dies takes the script it was running with it; the rest of
+    // the batch goes on with a new worker in its place.
+    int alive = workers;
+    while (alive > 0) {
+        int status;
+        pid_t pid = wait(&status);
+        if (pid < 0) {
+            break;
+        }
+        int worker = 0;
+        while (worker < workers && pids[worker] != pid) {
+            worker++;
+        }
+        if (worker == workers) {
+            continue;
+        }
+        alive--;
+        int script = shared->running[worker];
+        if (script >= 0) {
+            results[script].outcome = CRASHED;
+            if (shared->next < count) {
+                pids[worker] = startWorker(worker, scripts, count, output, base,
+                                           limits, shared, results);
+                alive++;
+            }
+        }
+    }
+    double elapsed = now() - start;
+
+    int failures = 0;
+    double total = 0;
+    for (int i = 0; i < count; i++) {
+        printf("%-10s %9.3fs  %s\n", outcomeNames[results[i].outcome],
+               results[i].seconds, scripts[i]);
+        if (results[i].outcome != PASSED) {
+            failures++;
+        }
+        total += results[i].seconds;
+    }
+    printf("%d scripts, %d failed, %.3fs of script time in %.3fs on %d worker%s\n",
+           count, failures, total, elapsed, workers, workers == 1 ? "" : "s");
+
+    for (int i = 0; i < count; i++) {
+        free(scripts[i]);
+    }
+    free(scripts);
+    munmap(shared, sharedSize);
+    return failures > 0;
+}
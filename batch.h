@@ -0,0 +1,18 @@
+#include "value.h"
+#include "governor.h"
+
+#ifndef _BATCH
+#define _BATCH
+
+// Run a batch of scripts: every .scm file in the directory at path, or every
+// file named (one per line) in the file at path. The scripts are shared out
+// among workers processes forked from this one, so the environment in base
+// (primitives and prelude) is set up once for all of them; each worker runs
+// its scripts one after another like a server runs requests, in a child frame
+// of base with memory of its own and under limits. What a script prints goes
+// to a file of its own: script.out next to it, or in the directory output
+// if that isn't NULL. Once all are done a summary of each script's outcome
+// and time is printed. Returns nonzero if a script failed or couldn't be run.
+int runBatch(char *path, char *output, int workers, Frame *base, Limits *limits);
+
+#endif
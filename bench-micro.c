@@ -0,0 +1,269 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "tokenizer.h"
+#include "parser.h"
+#include "linkedlist.h"
+#include "talloc.h"
+#include "interpreter.h"
+
+// Microbenchmarks for the stages of the interpreter taken one at a time:
+// tokenizing, parsing, looking up symbols, applying functions and talloc. Each
+// benchmark is run a few times to warm up and then timed over a number of
+// runs (21 unless given on the command line); the median and the 10th and
+// 90th percentiles of the runs are reported. Built and run by
+// `make bench-micro`.
+
+#define WARMUP 3
+#define DEFAULT_RUNS 21
+
+static int runs = DEFAULT_RUNS;
+
+// memory for the benchmarks, cleared after each run; the talloc benchmarks,
+// which free everything themselves, run before it is made
+static Region *scratch;
+
+static double now() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+static int compareDoubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// The value at fraction of the way through the sorted results.
+static double percentile(double *sorted, double fraction) {
+    return sorted[(int)(fraction * (runs - 1) + 0.5)];
+}
+
+// Time run, which does work units of something and returns how many, and
+// print the rate per second scaled by scale (or, if perUnit, the nanoseconds
+// per unit).
+static void measure(char *name, char *unit, double scale, int perUnit,
+                    double (*run)(void *data), void *data) {
+    double results[runs];
+    for (int i = -WARMUP; i < runs; i++) {
+        Region *previous = scratch != NULL ? useRegion(scratch) : NULL;
+        double start = now();
+        double work = run(data);
+        double elapsed = now() - start;
+        if (scratch != NULL) {
+            useRegion(previous);
+            clearRegion(scratch);
+        }
+        if (i >= 0) {
+            results[i] = perUnit ? elapsed * 1e9 / work : work / elapsed / scale;
+        }
+    }
+    qsort(results, runs, sizeof(double), compareDoubles);
+    printf("%-36s %-10s %12.2f %12.2f %12.2f\n", name, unit,
+           percentile(results, 0.5), percentile(results, 0.1),
+           percentile(results, 0.9));
+}
+
+// TALLOC
+
+#define ALLOCATIONS 1000000
+
+static double runTalloc(void *data) {
+    size_t size = *(size_t *)data;
+    for (int i = 0; i < ALLOCATIONS; i++) {
+        talloc(size);
+    }
+    tfree();
+    return ALLOCATIONS;
+}
+
+// TOKENIZE AND PARSE
+
+// A synthetic program of about size bytes, made of definitions and calls with
+// numbers, strings, booleans, nested lists and comments.
+static char *makeSource(size_t size, size_t *length) {
+    static char *lines[] = {
+        "; a comment about the next definition\n",
+        "(define (square-sum a b) (+ (* a a) (* b b)))\n",
+        "(define table (quote ((1 \"one\") (2 \"two\") (3.5 #t))))\n",
+        "(let ((x 10) (y -20.25)) (if (< x y) (list x y) (cons y x)))\n",
+        "(map (lambda (item) (cond ((null? item) #f) (else (car item)))) table)\n",
+    };
+    int count = sizeof(lines) / sizeof(lines[0]);
+    char *source = malloc(size + 128);
+    *length = 0;
+    for (int i = 0; *length < size; i = (i + 1) % count) {
+        strcpy(source + *length, lines[i]);
+        *length += strlen(lines[i]);
+    }
+    return source;
+}
+
+typedef struct Text {
+    char *source;
+    size_t length;
+} Text;
+
+static Value *tokenizeSample(Text *text) {
+    FILE *stream = fmemopen(text->source, text->length, "r");
+    Value *tokens = tokenizeStream(stream, NULL);
+    fclose(stream);
+    return tokens;
+}
+
+static double runTokenize(void *data) {
+    Text *text = data;
+    tokenizeSample(text);
+    return text->length;
+}
+
+typedef struct Tokens {
+    Value *tokens;
+    long nodes;
+} Tokens;
+
+// number of cons cells and atoms in tree
+static long countNodes(Value *tree) {
+    long nodes = 0;
+    for (; tree->type == CONS_TYPE; tree = cdr(tree)) {
+        nodes += 1 + (car(tree)->type == CONS_TYPE ? countNodes(car(tree)) : 1);
+    }
+    return nodes;
+}
+
+static double runParse(void *data) {
+    Tokens *tokens = data;
+    parse(tokens->tokens);
+    return tokens->nodes;
+}
+
+// LOOKUP
+
+// bindings looked at per run, spread over as many lookups as that takes
+#define BINDINGS_SCANNED 4000000
+
+typedef struct Chain {
+    Frame *innermost;
+    Value *symbol;
+    int lookups;
+} Chain;
+
+// A chain of depth frames with count bindings each. The symbol looked up is
+// the first one bound in the outermost frame, which is the last binding
+// looked at.
+static Chain makeChain(int depth, int count) {
+    Chain chain = {NULL, NULL, BINDINGS_SCANNED / (depth * count)};
+    for (int d = 0; d < depth; d++) {
+        Frame *frame = talloc(sizeof(Frame));
+        frame->parent = chain.innermost;
+        frame->bindings = makeNull();
+        for (int i = 0; i < count; i++) {
+            Value *symbol = talloc(sizeof(Value));
+            symbol->type = SYMBOL_TYPE;
+            symbol->s = talloc(32);
+            sprintf(symbol->s, "variable-%d-%d", d, i);
+            Value *value = talloc(sizeof(Value));
+            value->type = INT_TYPE;
+            value->i = i;
+            frame->bindings = cons(cons(symbol, value), frame->bindings);
+            if (d == 0 && i == 0) {
+                chain.symbol = symbol;
+            }
+        }
+        chain.innermost = frame;
+    }
+    return chain;
+}
+
+static double runLookup(void *data) {
+    Chain *chain = data;
+    for (int i = 0; i < chain->lookups; i++) {
+        lookUpSymbol(chain->symbol, chain->innermost);
+    }
+    return chain->lookups;
+}
+
+// APPLY
+
+#define CALLS 100000
+
+typedef struct Call {
+    Value *function;
+    int argc;
+    Value *argv[2];
+} Call;
+
+// evaluate the expression in source in frame
+static Value *evalText(char *source, Frame *frame) {
+    Text text = {source, strlen(source)};
+    return eval(car(parse(tokenizeSample(&text))), frame);
+}
+
+static double runApply(void *data) {
+    Call *call = data;
+    for (int i = 0; i < CALLS; i++) {
+        applyArray(call->function, call->argc, call->argv);
+    }
+    return CALLS;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1) {
+        runs = atoi(argv[1]);
+        if (runs < 1) {
+            fprintf(stderr, "Usage: %s [runs]\n", argv[0]);
+            return 1;
+        }
+    }
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    printf("%-36s %-10s %12s %12s %12s\n", "benchmark", "unit", "median", "p10", "p90");
+
+    // before anything else, since each run ends in tfree
+    size_t sizes[] = {24, 48, 256};
+    for (int i = 0; i < 3; i++) {
+        char name[64];
+        sprintf(name, "talloc %zu bytes + tfree", sizes[i]);
+        measure(name, "M/s", 1e6, 0, runTalloc, &sizes[i]);
+    }
+    scratch = newRegion();
+
+    Text text;
+    text.source = makeSource(1 << 20, &text.length);
+    measure("tokenize 1MB", "MB/s", 1 << 20, 0, runTokenize, &text);
+
+    Tokens tokens;
+    tokens.tokens = tokenizeSample(&text);
+    tokens.nodes = countNodes(parse(tokens.tokens));
+    measure("parse 1MB of tokens", "Mnodes/s", 1e6, 0, runParse, &tokens);
+
+    int depths[] = {1, 4, 16, 64};
+    int counts[] = {1, 8, 64};
+    for (int d = 0; d < 4; d++) {
+        for (int c = 0; c < 3; c++) {
+            char name[64];
+            sprintf(name, "lookUpSymbol depth %d, %d bindings", depths[d], counts[c]);
+            Chain chain = makeChain(depths[d], counts[c]);
+            measure(name, "ns", 1, 1, runLookup, &chain);
+        }
+    }
+
+    Frame *global = makeGlobalFrame();
+    Value *one = evalText("1", global);
+    Value *two = evalText("2", global);
+    Call calls[] = {
+        {evalText("+", global), 2, {one, two}},
+        {evalText("car", global), 1, {evalText("(quote (1 2))", global)}},
+        {evalText("(lambda (x) (quote done))", global), 1, {one}},
+        {evalText("(lambda (x y) (+ x y))", global), 2, {one, two}},
+    };
+    char *names[] = {"apply primitive + (2 args)", "apply primitive car (1 arg)",
+                     "apply closure, interpreted", "apply closure, native code"};
+    for (int i = 0; i < 4; i++) {
+        measure(names[i], "ns", 1, 1, runApply, &calls[i]);
+    }
+
+    free(text.source);
+    tfree();
+    return 0;
+}
@@ -0,0 +1,498 @@
+#include "expand.h"
+#include "interpreter.h"
+#include "linkedlist.h"
+#include "talloc.h"
+#include "promote.h"
+#include "quicken.h"
+#include <stdio.h>
+#include <string.h>
+
+// What a pattern variable matched. At depth 0 match is the form itself; at
+// depth n it is a list of the depth n-1 matches, one per repetition of the
+// ellipsis the variable was under.
+typedef struct Binding {
+    char *name;
+    int depth;
+    Value *match;
+    struct Binding *next;
+} Binding;
+
+// a symbol the template binds, and the fresh name it gets in one expansion
+typedef struct Rename {
+    char *name;
+    Value *symbol;
+    struct Rename *next;
+} Rename;
+
+// numbers the fresh names of renamed bindings
+static __thread int renameCount;
+
+static void syntaxError(char *message, char *name) {
+    printf("Syntax error: %s '%s'.\n", message, name);
+    texit(1);
+}
+
+static int isSymbol(Value *value, char *name) {
+    return value->type == SYMBOL_TYPE && !strcmp(value->s, name);
+}
+
+// whether the element after the head of list is an ellipsis
+static int beforeEllipsis(Value *list) {
+    return cdr(list)->type == CONS_TYPE && isSymbol(car(cdr(list)), "...");
+}
+
+static int isLiteral(Value *symbol, Value *literals) {
+    for (; !isNull(literals); literals = cdr(literals)) {
+        if (!strcmp(car(literals)->s, symbol->s)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static Binding *bind(char *name, int depth, Value *match, Binding *next) {
+    Binding *binding = talloc(sizeof(Binding));
+    binding->name = name;
+    binding->depth = depth;
+    binding->match = match;
+    binding->next = next;
+    return binding;
+}
+
+static Binding *findBinding(Binding *bindings, char *name) {
+    for (; bindings != NULL; bindings = bindings->next) {
+        if (!strcmp(bindings->name, name)) {
+            return bindings;
+        }
+    }
+    return NULL;
+}
+
+// Add the pattern variables of pattern to bindings, each bound at depth to an
+// empty list, for an ellipsis that matched nothing.
+static Binding *bindEmpty(Value *pattern, Value *literals, int depth, Binding *bindings) {
+    if (pattern->type == SYMBOL_TYPE) {
+        if (!isSymbol(pattern, "_") && !isSymbol(pattern, "...") &&
+            !isLiteral(pattern, literals)) {
+            bindings = bind(pattern->s, depth, makeNull(), bindings);
+        }
+    } else if (pattern->type == CONS_TYPE) {
+        for (; pattern->type == CONS_TYPE; pattern = cdr(pattern)) {
+            int inner = beforeEllipsis(pattern) ? depth + 1 : depth;
+            bindings = bindEmpty(car(pattern), literals, inner, bindings);
+        }
+    }
+    return bindings;
+}
+
+// constants in patterns match equal constants
+static int sameConstant(Value *a, Value *b) {
+    if (a->type != b->type) {
+        return 0;
+    }
+    switch (a->type) {
+        case INT_TYPE:
+            return a->i == b->i;
+        case DOUBLE_TYPE:
+            return a->d == b->d;
+        case STR_TYPE:
+        case BOOL_TYPE:
+            return !strcmp(a->s, b->s);
+        default:
+            return 0;
+    }
+}
+
+static int match(Value *pattern, Value *form, Value *literals, Binding **bindings);
+
+// Match the list pattern against the list form. An element followed by an
+// ellipsis takes as many forms as the rest of the pattern leaves over.
+static int matchList(Value *pattern, Value *form, Value *literals, Binding **bindings) {
+    while (pattern->type == CONS_TYPE) {
+        if (!beforeEllipsis(pattern)) {
+            if (form->type != CONS_TYPE || !match(car(pattern), car(form), literals, bindings)) {
+                return 0;
+            }
+            pattern = cdr(pattern);
+            form = cdr(form);
+            continue;
+        }
+
+        Value *element = car(pattern);
+        Value *after = cdr(cdr(pattern));
+        int available = 0;
+        for (Value *rest = form; rest->type == CONS_TYPE; rest = cdr(rest)) {
+            available++;
+        }
+        available -= length(after);
+        if (available < 0) {
+            return 0;
+        }
+
+        // match each repetition on its own, then gather every variable's
+        // matches into a list bound one level deeper
+        Binding *repetitions[available > 0 ? available : 1];
+        for (int i = 0; i < available; i++) {
+            repetitions[i] = NULL;
+            if (!match(element, car(form), literals, &repetitions[i])) {
+                return 0;
+            }
+            form = cdr(form);
+        }
+        Binding *gathered = bindEmpty(element, literals, 1, NULL);
+        for (Binding *variable = gathered; variable != NULL; variable = variable->next) {
+            Value *matches = makeNull();
+            for (int i = available - 1; i >= 0; i--) {
+                Binding *one = findBinding(repetitions[i], variable->name);
+                matches = cons(one->match, matches);
+                variable->depth = one->depth + 1;
+            }
+            variable->match = matches;
+        }
+        while (gathered != NULL) {
+            Binding *next = gathered->next;
+            gathered->next = *bindings;
+            *bindings = gathered;
+            gathered = next;
+        }
+        pattern = after;
+    }
+    return isNull(form);
+}
+
+// Match pattern against form, adding what its variables matched to bindings.
+static int match(Value *pattern, Value *form, Value *literals, Binding **bindings) {
+    switch (pattern->type) {
+        case SYMBOL_TYPE:
+            if (isSymbol(pattern, "_")) {
+                return 1;
+            }
+            if (isLiteral(pattern, literals)) {
+                return isSymbol(form, pattern->s);
+            }
+            *bindings = bind(pattern->s, 0, form, *bindings);
+            return 1;
+        case CONS_TYPE:
+            return (form->type == CONS_TYPE || form->type == NULL_TYPE) &&
+                   matchList(pattern, form, literals, bindings);
+        case NULL_TYPE:
+            return form->type == NULL_TYPE;
+        default:
+            return sameConstant(pattern, form);
+    }
+}
+
+// Collect the names the template binds with lambda or let, other than pattern
+// variables, so each expansion can give them fresh names.
+static Rename *findBinders(Value *template, Binding *bindings, Rename *renames) {
+    if (template->type != CONS_TYPE) {
+        return renames;
+    }
+    Value *binders = makeNull();
+    Value *head = car(template);
+    if (cdr(template)->type == CONS_TYPE) {
+        Value *second = car(cdr(template));
+        if (isSymbol(head, "lambda")) {
+            for (; second->type == CONS_TYPE; second = cdr(second)) {
+                binders = cons(car(second), binders);
+            }
+        } else if (isSymbol(head, "let") || isSymbol(head, "let*") ||
+                   isSymbol(head, "letrec")) {
+            for (; second->type == CONS_TYPE; second = cdr(second)) {
+                if (car(second)->type == CONS_TYPE) {
+                    binders = cons(car(car(second)), binders);
+                }
+            }
+        }
+    }
+    for (; !isNull(binders); binders = cdr(binders)) {
+        Value *name = car(binders);
+        if (name->type != SYMBOL_TYPE || findBinding(bindings, name->s) != NULL) {
+            continue;
+        }
+        Rename *rename = renames;
+        while (rename != NULL && strcmp(rename->name, name->s)) {
+            rename = rename->next;
+        }
+        if (rename == NULL) {
+            rename = talloc(sizeof(Rename));
+            rename->name = name->s;
+            rename->symbol = NULL;
+            rename->next = renames;
+            renames = rename;
+        }
+    }
+    for (; template->type == CONS_TYPE; template = cdr(template)) {
+        renames = findBinders(car(template), bindings, renames);
+    }
+    return renames;
+}
+
+// Whether template uses a variable bound under an ellipsis, which is what an
+// ellipsis after it repeats over.
+static int usesRepeated(Value *template, Binding *bindings) {
+    if (template->type == SYMBOL_TYPE) {
+        Binding *binding = findBinding(bindings, template->s);
+        return binding != NULL && binding->depth > 0;
+    }
+    for (; template->type == CONS_TYPE; template = cdr(template)) {
+        if (usesRepeated(car(template), bindings)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Add to result the i-th repetition of every variable in all that template
+// uses under an ellipsis, setting ended once i is past the end of one.
+static Binding *repetition(Value *template, Binding *all, int i, Binding *result,
+                           int *ended) {
+    if (template->type == SYMBOL_TYPE) {
+        Binding *binding = findBinding(all, template->s);
+        if (binding != NULL && binding->depth > 0 && findBinding(result, template->s) == NULL) {
+            Value *matches = binding->match;
+            for (int skip = 0; skip < i && !isNull(matches); skip++) {
+                matches = cdr(matches);
+            }
+            if (isNull(matches)) {
+                *ended = 1;
+                return result;
+            }
+            result = bind(binding->name, binding->depth - 1, car(matches), result);
+        }
+        return result;
+    }
+    for (; template->type == CONS_TYPE; template = cdr(template)) {
+        result = repetition(car(template), all, i, result, ended);
+    }
+    return result;
+}
+
+// Build the expansion of template from what the pattern variables matched.
+static Value *instantiate(Value *template, Binding *bindings, Rename *renames) {
+    if (template->type == SYMBOL_TYPE) {
+        Binding *binding = findBinding(bindings, template->s);
+        if (binding != NULL) {
+            if (binding->depth > 0) {
+                syntaxError("missing ellipsis after", template->s);
+            }
+            return binding->match;
+        }
+        for (; renames != NULL; renames = renames->next) {
+            if (!strcmp(renames->name, template->s)) {
+                return renames->symbol;
+            }
+        }
+        return template;
+    }
+    if (template->type != CONS_TYPE) {
+        return template;
+    }
+    // quoted data keeps the names it was written with; only pattern
+    // variables are filled in
+    if (car(template)->type == SYMBOL_TYPE && !strcmp(car(template)->s, "quote") &&
+        findBinding(bindings, "quote") == NULL) {
+        renames = NULL;
+    }
+
+    Value *result = makeNull();
+    while (template->type == CONS_TYPE) {
+        Value *element = car(template);
+        if (!beforeEllipsis(template)) {
+            result = cons(instantiate(element, bindings, renames), result);
+            template = cdr(template);
+            continue;
+        }
+        if (!usesRepeated(element, bindings)) {
+            syntaxError("nothing to repeat before", "...");
+        }
+        for (int i = 0;; i++) {
+            int ended = 0;
+            Binding *one = repetition(element, bindings, i, NULL, &ended);
+            if (ended) {
+                break;
+            }
+            Binding *shadowed = one;
+            while (shadowed->next != NULL) {
+                shadowed = shadowed->next;
+            }
+            shadowed->next = bindings;
+            result = cons(instantiate(element, one, renames), result);
+        }
+        template = cdr(cdr(template));
+    }
+    return reverse(result);
+}
+
+// Expand one use of macro, trying its rules in order.
+static Value *expandUse(Value *macro, Value *form) {
+    for (Value *rules = macro->mc.rules; !isNull(rules); rules = cdr(rules)) {
+        Value *pattern = car(car(rules));
+        Value *template = car(cdr(car(rules)));
+        Binding *bindings = NULL;
+        if (!match(cdr(pattern), cdr(form), macro->mc.literals, &bindings)) {
+            continue;
+        }
+        Rename *renames = findBinders(template, bindings, NULL);
+        for (Rename *rename = renames; rename != NULL; rename = rename->next) {
+            // '#' can't appear in a symbol the tokenizer reads, so the fresh
+            // name can't clash with one in the program
+            char fresh[32];
+            int length = snprintf(fresh, sizeof(fresh), "#%i", ++renameCount);
+            rename->symbol = talloc(sizeof(Value));
+            rename->symbol->type = SYMBOL_TYPE;
+            rename->symbol->s = talloc(strlen(rename->name) + length + 1);
+            strcpy(rename->symbol->s, rename->name);
+            strcat(rename->symbol->s, fresh);
+        }
+        return instantiate(template, bindings, renames);
+    }
+    syntaxError("no syntax-rules pattern matches this use of", car(form)->s);
+    return NULL;
+}
+
+// Make a macro from (syntax-rules (literal ...) (pattern template) ...).
+static Value *makeMacro(Value *spec, char *name) {
+    if (spec->type != CONS_TYPE || !isSymbol(car(spec), "syntax-rules") ||
+        cdr(spec)->type != CONS_TYPE) {
+        syntaxError("expected syntax-rules in define-syntax of", name);
+    }
+    Value *literals = car(cdr(spec));
+    for (Value *literal = literals; !isNull(literal); literal = cdr(literal)) {
+        if (literal->type != CONS_TYPE || car(literal)->type != SYMBOL_TYPE) {
+            syntaxError("bad literals in define-syntax of", name);
+        }
+    }
+    Value *rules = cdr(cdr(spec));
+    for (Value *rule = rules; !isNull(rule); rule = cdr(rule)) {
+        if (car(rule)->type != CONS_TYPE || car(car(rule))->type != CONS_TYPE ||
+            length(car(rule)) != 2) {
+            syntaxError("bad rule in define-syntax of", name);
+        }
+    }
+    Value *macro = talloc(sizeof(Value));
+    macro->type = MACRO_TYPE;
+    macro->mc.literals = literals;
+    macro->mc.rules = rules;
+    return macro;
+}
+
+// the macro name is bound to in frame, or NULL
+static Value *findMacro(Value *name, Frame *frame) {
+    if (name->type != SYMBOL_TYPE) {
+        return NULL;
+    }
+    Value *value = lookUpName(name->s, frame);
+    return value != NULL && value->type == MACRO_TYPE ? value : NULL;
+}
+
+static Value *expandExpression(Value *form, Frame *frame);
+
+// Expand each element of list, sharing the list if nothing changed.
+static Value *expandEach(Value *list, Frame *frame) {
+    if (list->type != CONS_TYPE) {
+        return list;
+    }
+    Value *head = expandExpression(car(list), frame);
+    Value *tail = expandEach(cdr(list), frame);
+    if (head == car(list) && tail == cdr(list)) {
+        return list;
+    }
+    return cons(head, tail);
+}
+
+// Expand the (name expression) pairs of a let, leaving the names alone.
+static Value *expandBindings(Value *bindings, Frame *frame) {
+    if (bindings->type != CONS_TYPE) {
+        return bindings;
+    }
+    Value *binding = car(bindings);
+    Value *expanded = binding;
+    if (binding->type == CONS_TYPE) {
+        Value *rest = expandEach(cdr(binding), frame);
+        if (rest != cdr(binding)) {
+            expanded = cons(car(binding), rest);
+        }
+    }
+    Value *tail = expandBindings(cdr(bindings), frame);
+    if (expanded == binding && tail == cdr(bindings)) {
+        return bindings;
+    }
+    return cons(expanded, tail);
+}
+
+// Expand the macro uses in an expression. Special forms are walked by their
+// shape, so that quoted data and the names being bound are left alone.
+static Value *expandExpression(Value *form, Frame *frame) {
+    for (;;) {
+        if (form->type != CONS_TYPE) {
+            return form;
+        }
+        Value *macro = findMacro(car(form), frame);
+        if (macro == NULL) {
+            break;
+        }
+        form = expandUse(macro, form);
+    }
+
+    Value *head = car(form);
+    Value *args = cdr(form);
+    if (isSymbol(head, "quote")) {
+        return form;
+    }
+    if (isSymbol(head, "define-syntax")) {
+        syntaxError("only allowed at the top level:", "define-syntax");
+    }
+    if (isSymbol(head, "lambda")) {
+        // the body is expanded when the closure is first applied
+        return form;
+    }
+    if (isSymbol(head, "define") && args->type == CONS_TYPE) {
+        Value *rest = expandEach(cdr(args), frame);
+        return rest == cdr(args) ? form : cons(head, cons(car(args), rest));
+    }
+    if ((isSymbol(head, "let") || isSymbol(head, "let*") || isSymbol(head, "letrec")) &&
+        args->type == CONS_TYPE) {
+        Value *bindings = expandBindings(car(args), frame);
+        Value *body = expandEach(cdr(args), frame);
+        if (bindings == car(args) && body == cdr(args)) {
+            return form;
+        }
+        return cons(head, cons(bindings, body));
+    }
+    if (isSymbol(head, "cond")) {
+        Value *clauses = makeNull();
+        int changed = 0;
+        for (Value *clause = args; clause->type == CONS_TYPE; clause = cdr(clause)) {
+            Value *expanded = expandEach(car(clause), frame);
+            changed |= expanded != car(clause);
+            clauses = cons(expanded, clauses);
+        }
+        return changed ? cons(head, reverse(clauses)) : form;
+    }
+    return expandEach(form, frame);
+}
+
+Value *expand(Value *form, Frame *frame) {
+    if (form->type == CONS_TYPE && isSymbol(car(form), "define-syntax")) {
+        Value *args = cdr(form);
+        if (length(args) != 2 || car(args)->type != SYMBOL_TYPE) {
+            syntaxError("bad form of", "define-syntax");
+        }
+        Value *macro = makeMacro(car(cdr(args)), car(args)->s);
+        noteBinding(car(args)->s);
+        frame->bindings = cons(cons(car(args), macro), frame->bindings);
+        rememberFrame(frame);
+
+        Value *begin = talloc(sizeof(Value));
+        begin->type = SYMBOL_TYPE;
+        begin->s = "begin";
+        return cons(begin, makeNull());
+    }
+    return expandExpression(form, frame);
+}
+
+// Expand the macros used in the body of a lambda, looking them up in frame.
+Value *expandBody(Value *body, Frame *frame) {
+    return expandExpression(body, frame);
+}
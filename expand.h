@@ -0,0 +1,20 @@
+#include "value.h"
+
+#ifndef _EXPAND
+#define _EXPAND
+
+// Expand the macros used in a top-level form before it is evaluated in frame,
+// returning the rewritten form (the form itself if it uses none). A
+// (define-syntax name (syntax-rules ...)) form binds name to the macro in
+// frame and becomes (begin), so it evaluates to nothing. Macros are looked up
+// by name in frame; expansion rewrites the tree once, so evaluating it later,
+// however often, costs nothing extra.
+Value *expand(Value *form, Frame *frame);
+
+// expand leaves the bodies of lambdas alone, so that functions that are never
+// called cost nothing to expand; the body of a closure is expanded by this,
+// with its macros looked up in the closure's frame, when the closure is
+// first applied.
+Value *expandBody(Value *body, Frame *frame);
+
+#endif
@@ -0,0 +1,357 @@
+#include "f64vector.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+
+// SSE2 is part of x86-64, so these always work.
+
+static void addBase(double *out, const double *a, const double *b, size_t n) {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(out + i, _mm_add_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+    }
+    for (; i < n; i++) {
+        out[i] = a[i] + b[i];
+    }
+}
+
+static void mulBase(double *out, const double *a, const double *b, size_t n) {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(out + i, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+    }
+    for (; i < n; i++) {
+        out[i] = a[i] * b[i];
+    }
+}
+
+static void scaleBase(double *out, const double *a, double k, size_t n) {
+    __m128d factor = _mm_set1_pd(k);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(out + i, _mm_mul_pd(_mm_loadu_pd(a + i), factor));
+    }
+    for (; i < n; i++) {
+        out[i] = a[i] * k;
+    }
+}
+
+static double dotBase(const double *a, const double *b, size_t n) {
+    __m128d sum0 = _mm_setzero_pd();
+    __m128d sum1 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        sum0 = _mm_add_pd(sum0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+        sum1 = _mm_add_pd(sum1, _mm_mul_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(sum0, sum1));
+    double sum = lanes[0] + lanes[1];
+    for (; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+static double sumBase(const double *a, size_t n) {
+    __m128d sum0 = _mm_setzero_pd();
+    __m128d sum1 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        sum0 = _mm_add_pd(sum0, _mm_loadu_pd(a + i));
+        sum1 = _mm_add_pd(sum1, _mm_loadu_pd(a + i + 2));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(sum0, sum1));
+    double sum = lanes[0] + lanes[1];
+    for (; i < n; i++) {
+        sum += a[i];
+    }
+    return sum;
+}
+
+static double minBase(const double *a, size_t n) {
+    __m128d least = _mm_set1_pd(a[0]);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        least = _mm_min_pd(least, _mm_loadu_pd(a + i));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, least);
+    double result = lanes[0] < lanes[1] ? lanes[0] : lanes[1];
+    for (; i < n; i++) {
+        result = a[i] < result ? a[i] : result;
+    }
+    return result;
+}
+
+static double maxBase(const double *a, size_t n) {
+    __m128d most = _mm_set1_pd(a[0]);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        most = _mm_max_pd(most, _mm_loadu_pd(a + i));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, most);
+    double result = lanes[0] > lanes[1] ? lanes[0] : lanes[1];
+    for (; i < n; i++) {
+        result = a[i] > result ? a[i] : result;
+    }
+    return result;
+}
+
+// The AVX2 versions work on four doubles at a time, with more accumulators
+// for the reductions so they keep up with memory.
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static void addAVX2(double *out, const double *a, const double *b, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    }
+    for (; i < n; i++) {
+        out[i] = a[i] + b[i];
+    }
+}
+
+AVX2 static void mulAVX2(double *out, const double *a, const double *b, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    }
+    for (; i < n; i++) {
+        out[i] = a[i] * b[i];
+    }
+}
+
+AVX2 static void scaleAVX2(double *out, const double *a, double k, size_t n) {
+    __m256d factor = _mm256_set1_pd(k);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_loadu_pd(a + i), factor));
+    }
+    for (; i < n; i++) {
+        out[i] = a[i] * k;
+    }
+}
+
+// add up the four lanes of each of the four accumulators
+AVX2 static double total(__m256d sum0, __m256d sum1, __m256d sum2, __m256d sum3) {
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(_mm256_add_pd(sum0, sum1), _mm256_add_pd(sum2, sum3)));
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+AVX2 static double dotAVX2(const double *a, const double *b, size_t n) {
+    __m256d sum0 = _mm256_setzero_pd();
+    __m256d sum1 = _mm256_setzero_pd();
+    __m256d sum2 = _mm256_setzero_pd();
+    __m256d sum3 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        sum0 = _mm256_add_pd(sum0, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+        sum1 = _mm256_add_pd(sum1, _mm256_mul_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4)));
+        sum2 = _mm256_add_pd(sum2, _mm256_mul_pd(_mm256_loadu_pd(a + i + 8), _mm256_loadu_pd(b + i + 8)));
+        sum3 = _mm256_add_pd(sum3, _mm256_mul_pd(_mm256_loadu_pd(a + i + 12), _mm256_loadu_pd(b + i + 12)));
+    }
+    double sum = total(sum0, sum1, sum2, sum3);
+    for (; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+AVX2 static double sumAVX2(const double *a, size_t n) {
+    __m256d sum0 = _mm256_setzero_pd();
+    __m256d sum1 = _mm256_setzero_pd();
+    __m256d sum2 = _mm256_setzero_pd();
+    __m256d sum3 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        sum0 = _mm256_add_pd(sum0, _mm256_loadu_pd(a + i));
+        sum1 = _mm256_add_pd(sum1, _mm256_loadu_pd(a + i + 4));
+        sum2 = _mm256_add_pd(sum2, _mm256_loadu_pd(a + i + 8));
+        sum3 = _mm256_add_pd(sum3, _mm256_loadu_pd(a + i + 12));
+    }
+    double sum = total(sum0, sum1, sum2, sum3);
+    for (; i < n; i++) {
+        sum += a[i];
+    }
+    return sum;
+}
+
+AVX2 static double minAVX2(const double *a, size_t n) {
+    __m256d least = _mm256_set1_pd(a[0]);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        least = _mm256_min_pd(least, _mm256_loadu_pd(a + i));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, least);
+    double result = lanes[0];
+    for (int lane = 1; lane < 4; lane++) {
+        result = lanes[lane] < result ? lanes[lane] : result;
+    }
+    for (; i < n; i++) {
+        result = a[i] < result ? a[i] : result;
+    }
+    return result;
+}
+
+AVX2 static double maxAVX2(const double *a, size_t n) {
+    __m256d most = _mm256_set1_pd(a[0]);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        most = _mm256_max_pd(most, _mm256_loadu_pd(a + i));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, most);
+    double result = lanes[0];
+    for (int lane = 1; lane < 4; lane++) {
+        result = lanes[lane] > result ? lanes[lane] : result;
+    }
+    for (; i < n; i++) {
+        result = a[i] > result ? a[i] : result;
+    }
+    return result;
+}
+
+#else
+
+// Portable versions for other machines, which the compiler may vectorize.
+
+static void addBase(double *out, const double *a, const double *b, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        out[i] = a[i] + b[i];
+    }
+}
+
+static void mulBase(double *out, const double *a, const double *b, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        out[i] = a[i] * b[i];
+    }
+}
+
+static void scaleBase(double *out, const double *a, double k, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        out[i] = a[i] * k;
+    }
+}
+
+static double dotBase(const double *a, const double *b, size_t n) {
+    double sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+static double sumBase(const double *a, size_t n) {
+    double sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        sum += a[i];
+    }
+    return sum;
+}
+
+static double minBase(const double *a, size_t n) {
+    double result = a[0];
+    for (size_t i = 1; i < n; i++) {
+        result = a[i] < result ? a[i] : result;
+    }
+    return result;
+}
+
+static double maxBase(const double *a, size_t n) {
+    double result = a[0];
+    for (size_t i = 1; i < n; i++) {
+        result = a[i] > result ? a[i] : result;
+    }
+    return result;
+}
+
+#endif
+
+// the kernels in use, chosen by chooseKernels
+static struct {
+    void (*add)(double *, const double *, const double *, size_t);
+    void (*mul)(double *, const double *, const double *, size_t);
+    void (*scale)(double *, const double *, double, size_t);
+    double (*dot)(const double *, const double *, size_t);
+    double (*sum)(const double *, size_t);
+    double (*min)(const double *, size_t);
+    double (*max)(const double *, size_t);
+} kernels;
+
+// pick the widest kernels this CPU runs
+static void chooseKernels() {
+    kernels.add = addBase;
+    kernels.mul = mulBase;
+    kernels.scale = scaleBase;
+    kernels.dot = dotBase;
+    kernels.sum = sumBase;
+    kernels.min = minBase;
+    kernels.max = maxBase;
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        kernels.add = addAVX2;
+        kernels.mul = mulAVX2;
+        kernels.scale = scaleAVX2;
+        kernels.dot = dotAVX2;
+        kernels.sum = sumAVX2;
+        kernels.min = minAVX2;
+        kernels.max = maxAVX2;
+    }
+#endif
+}
+
+void f64Add(double *out, const double *a, const double *b, size_t n) {
+    if (kernels.add == NULL) {
+        chooseKernels();
+    }
+    kernels.add(out, a, b, n);
+}
+
+void f64Mul(double *out, const double *a, const double *b, size_t n) {
+    if (kernels.mul == NULL) {
+        chooseKernels();
+    }
+    kernels.mul(out, a, b, n);
+}
+
+void f64Scale(double *out, const double *a, double k, size_t n) {
+    if (kernels.scale == NULL) {
+        chooseKernels();
+    }
+    kernels.scale(out, a, k, n);
+}
+
+double f64Dot(const double *a, const double *b, size_t n) {
+    if (kernels.dot == NULL) {
+        chooseKernels();
+    }
+    return kernels.dot(a, b, n);
+}
+
+double f64Sum(const double *a, size_t n) {
+    if (kernels.sum == NULL) {
+        chooseKernels();
+    }
+    return kernels.sum(a, n);
+}
+
+double f64Min(const double *a, size_t n) {
+    if (kernels.min == NULL) {
+        chooseKernels();
+    }
+    return kernels.min(a, n);
+}
+
+double f64Max(const double *a, size_t n) {
+    if (kernels.max == NULL) {
+        chooseKernels();
+    }
+    return kernels.max(a, n);
+}
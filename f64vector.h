@@ -0,0 +1,31 @@
+#include <stddef.h>
+
+#ifndef _F64VECTOR
+#define _F64VECTOR
+
+// Numeric kernels over contiguous arrays of doubles, used by the f64vector
+// primitives. On x86-64 each one has an SSE2 and an AVX2 version, and the
+// AVX2 ones are picked the first time a kernel runs if the CPU supports them.
+// Sums are accumulated in several lanes, so they can differ in the last bits
+// from adding the elements in order.
+
+// out[i] = a[i] + b[i]
+void f64Add(double *out, const double *a, const double *b, size_t n);
+
+// out[i] = a[i] * b[i]
+void f64Mul(double *out, const double *a, const double *b, size_t n);
+
+// out[i] = a[i] * k
+void f64Scale(double *out, const double *a, double k, size_t n);
+
+// sum of a[i] * b[i]
+double f64Dot(const double *a, const double *b, size_t n);
+
+// sum of a[i]
+double f64Sum(const double *a, size_t n);
+
+// smallest and largest of a[i]; n must be at least 1
+double f64Min(const double *a, size_t n);
+double f64Max(const double *a, size_t n);
+
+#endif
@@ -0,0 +1,235 @@
+#include "governor.h"
+#include "talloc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <sys/time.h>
+
+// Steps between looks at the clock while there is a time limit.
+#define CLOCK_INTERVAL 4096
+
+// The limits in force, as absolute values of the counters below.
+typedef struct Bounds {
+    long steps;
+    double deadline;
+    long depth;
+    size_t bytes;
+} Bounds;
+
+// Each thread is governed on its own.
+static __thread long steps;
+static __thread long depth;
+static __thread Bounds bounds = {LONG_MAX, 0, LONG_MAX, SIZE_MAX};
+
+// the step count at which countStep next has to look at the limits
+static __thread long nextCheck = LONG_MAX;
+
+// where the timer signal jumps to while native code runs
+static __thread sigjmp_buf *nativeEscape;
+
+// bounds saved by pushLimits
+static __thread Bounds *saved;
+static __thread int savedCount;
+static __thread int savedCapacity;
+
+// set in threads started by governThread, which leave the timer signal and
+// the memory limit, both shared by the whole process, to the main thread
+static __thread int secondary;
+
+static double now() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+// Only native code is interrupted; interpreted code looks at the clock itself.
+static void onAlarm(int signal) {
+    if (nativeEscape != NULL) {
+        siglongjmp(*nativeEscape, 1);
+    }
+}
+
+// make the timer signal go off at the deadline, or not at all if there is none
+static void setAlarm(double deadline) {
+    static int installed;
+    if (!installed) {
+        installed = 1;
+        struct sigaction action;
+        action.sa_handler = onAlarm;
+        sigemptyset(&action.sa_mask);
+        action.sa_flags = 0;
+        sigaction(SIGALRM, &action, NULL);
+    }
+    struct itimerval timer = {{0, 0}, {0, 0}};
+    if (deadline != 0) {
+        double left = deadline - now();
+        if (left < 1e-6) {
+            left = 1e-6;
+        }
+        timer.it_value.tv_sec = (time_t)left;
+        timer.it_value.tv_usec = (suseconds_t)((left - (time_t)left) * 1e6);
+        if (timer.it_value.tv_sec == 0 && timer.it_value.tv_usec == 0) {
+            timer.it_value.tv_usec = 1;
+        }
+    }
+    setitimer(ITIMER_REAL, &timer, NULL);
+}
+
+// make bounds the limits in force
+static void enforce(Bounds *next) {
+    if (next->deadline != bounds.deadline && !secondary) {
+        setAlarm(next->deadline);
+    }
+    bounds = *next;
+    nextCheck = bounds.steps;
+    if (bounds.deadline != 0 && steps + CLOCK_INTERVAL < nextCheck) {
+        nextCheck = steps + CLOCK_INTERVAL;
+    }
+    if (!secondary) {
+        limitAllocation(bounds.bytes);
+    }
+}
+
+// lift every limit and end evaluation with an error about the one exceeded
+static void exceeded(char *what) {
+    setLimits(NULL);
+    printf("Evaluation error: %s limit exceeded.\n", what);
+    texit(1);
+}
+
+// Enforce limits, counted from now, instead of any limits in force.
+void setLimits(Limits *limits) {
+    savedCount = 0;
+    steps = 0;
+    depth = 0;
+    Bounds next = {LONG_MAX, 0, LONG_MAX, SIZE_MAX};
+    enforce(&next);
+    if (limits != NULL) {
+        // tighten the unlimited bounds, which needn't be gone back to
+        pushLimits(limits);
+        savedCount = 0;
+    }
+}
+
+// Also enforce limits, counted from now, on top of the limits in force.
+void pushLimits(Limits *limits) {
+    if (savedCount == savedCapacity) {
+        savedCapacity = savedCapacity ? savedCapacity * 2 : 16;
+        saved = realloc(saved, savedCapacity * sizeof(Bounds));
+    }
+    saved[savedCount++] = bounds;
+
+    Bounds next = bounds;
+    if (limits->steps > 0 && limits->steps < next.steps - steps) {
+        next.steps = steps + limits->steps;
+    }
+    if (limits->seconds > 0) {
+        double deadline = now() + limits->seconds;
+        if (next.deadline == 0 || deadline < next.deadline) {
+            next.deadline = deadline;
+        }
+    }
+    if (limits->depth > 0 && limits->depth < next.depth - depth) {
+        next.depth = depth + limits->depth;
+    }
+    size_t allocated = allocatedBytes();
+    if (limits->bytes > 0 && limits->bytes < next.bytes - allocated) {
+        next.bytes = allocated + limits->bytes;
+    }
+    enforce(&next);
+}
+
+// The step, time and depth limits in force, as amounts left from now.
+Limits remainingLimits() {
+    Limits left = {0, 0, 0, 0};
+    if (bounds.steps != LONG_MAX) {
+        left.steps = bounds.steps > steps ? bounds.steps - steps : 1;
+    }
+    if (bounds.deadline != 0) {
+        left.seconds = bounds.deadline - now();
+        if (left.seconds < 1e-6) {
+            left.seconds = 1e-6;
+        }
+    }
+    if (bounds.depth != LONG_MAX) {
+        left.depth = bounds.depth > depth ? bounds.depth - depth : 1;
+    }
+    return left;
+}
+
+// Govern a thread other than the main one by limits.
+void governThread(Limits *limits) {
+    secondary = 1;
+    setLimits(limits);
+}
+
+// Go back to the limits in force before the last pushLimits.
+void popLimits() {
+    if (savedCount > 0) {
+        enforce(&saved[--savedCount]);
+    }
+}
+
+// the slow part of countStep, once the step count reaches nextCheck
+static void checkLimits() {
+    if (steps >= bounds.steps) {
+        exceeded("step");
+    }
+    if (bounds.deadline != 0 && now() > bounds.deadline) {
+        exceeded("time");
+    }
+    nextCheck = bounds.steps;
+    if (bounds.deadline != 0 && steps + CLOCK_INTERVAL < nextCheck) {
+        nextCheck = steps + CLOCK_INTERVAL;
+    }
+}
+
+// Count an evaluation step.
+void countStep() {
+    if (++steps >= nextCheck) {
+        checkLimits();
+    }
+}
+
+// Count the start of a closure call.
+void enterCall() {
+    if (++depth > bounds.depth) {
+        exceeded("recursion depth");
+    }
+}
+
+// Count the end of a closure call.
+void leaveCall() {
+    depth--;
+}
+
+// Whether a step or depth limit is in force.
+int isGoverned() {
+    return bounds.steps != LONG_MAX || bounds.depth != LONG_MAX ||
+           (secondary && bounds.deadline != 0);
+}
+
+// Call the entry point of native code on slots, under the time limit.
+int callNative(int (*entry)(int64_t *slots), int64_t *slots) {
+    if (bounds.deadline == 0) {
+        return entry(slots);
+    }
+    sigjmp_buf escape;
+    if (sigsetjmp(escape, 0) != 0) {
+        // the signal is still blocked, having been left by a jump
+        nativeEscape = NULL;
+        sigset_t alarm;
+        sigemptyset(&alarm);
+        sigaddset(&alarm, SIGALRM);
+        sigprocmask(SIG_UNBLOCK, &alarm, NULL);
+        exceeded("time");
+    }
+    nativeEscape = &escape;
+    int result = entry(slots);
+    nativeEscape = NULL;
+    return result;
+}
@@ -0,0 +1,58 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef _GOVERNOR
+#define _GOVERNOR
+
+// Limits on what evaluating a program may use. A field left at 0 sets no
+// limit. Going over a limit ends evaluation with an evaluation error.
+typedef struct Limits {
+    // evaluation steps, one per call to eval
+    long steps;
+    // wall-clock time
+    double seconds;
+    // closure calls in progress at once
+    long depth;
+    // bytes of memory held by talloc
+    size_t bytes;
+} Limits;
+
+// Enforce limits, counted from now, instead of any limits in force; NULL
+// lifts them all.
+void setLimits(Limits *limits);
+
+// Also enforce limits, counted from now, on top of the limits in force, until
+// the matching popLimits. Used by with-limits.
+void pushLimits(Limits *limits);
+
+// Go back to the limits in force before the last pushLimits.
+void popLimits();
+
+// The step, time and depth limits in force in the calling thread, as amounts
+// left from now; the memory limit is left at 0, being the process's.
+Limits remainingLimits();
+
+// Govern the calling thread, which isn't the main one, by limits. Each thread
+// counts its own steps and depth; such a thread looks at the clock itself
+// rather than setting the timer signal (so it doesn't run native code under a
+// time limit), and is held only to the main thread's memory limit.
+void governThread(Limits *limits);
+
+// Count an evaluation step.
+void countStep();
+
+// Count the start and the end of a closure call.
+void enterCall();
+void leaveCall();
+
+// Whether a step or depth limit is in force (or, in a thread started by
+// governThread, a time limit). Native code doesn't count steps or calls, so it
+// isn't run while one is.
+int isGoverned();
+
+// Call the entry point of native code on slots. Native code doesn't look at
+// the clock, so while there is a time limit a timer signal ends the call, with
+// an evaluation error, if the deadline passes.
+int callNative(int (*entry)(int64_t *slots), int64_t *slots);
+
+#endif
@@ -0,0 +1,631 @@
+#include "image.h"
+#include "interpreter.h"
+#include "linkedlist.h"
+#include "quicken.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// kinds of objects an image holds
+enum { VALUE_OBJECT, FRAME_OBJECT, STRING_OBJECT };
+
+#define IMAGE_ALIGNMENT 16
+#define IMAGE_MAGIC "SCMIMG02"
+
+// Datum files are laid out to be mapped at a fixed address, so that loading
+// one needn't relocate it: each file gets as many of the DATUM_SLOTS gigabyte
+// slots from DATUM_AREA on as it needs, starting at one picked by a hash of
+// its path.
+#define DATUM_AREA ((uintptr_t)0x200000000000)
+#define DATUM_SLOTS 16384
+#define DATUM_KEY 0x4D55544144
+
+// Atoms in datum files take only ATOM_SIZE bytes, like cons cells take only
+// CONS_SIZE; the data is followed by a Value's worth of padding so that
+// reading a whole Value at the last one stays inside the file.
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE 0
+#endif
+
+// An image file is this header, then the objects, then a bitmap with one bit
+// per 8-byte word of the objects marking the pointer fields, then (field,
+// name) offset pairs for every primitive function pointer, which are looked up
+// by name when loading. Pointer fields hold offsets from base, the address the
+// objects were laid out for (0 for images and trees, which are always
+// relocated).
+typedef struct {
+    char magic[8];
+    uint32_t valueSize;
+    uint32_t frameSize;
+    uint64_t key;
+    uint64_t size;
+    uint64_t root;
+    uint64_t relocations;
+    uint64_t primitives;
+    uint64_t base;
+} ImageHeader;
+
+// a pointer field that still has to be filled in with its target's offset
+typedef struct {
+    void *target;
+    int kind;
+    uint64_t field;
+} Pending;
+
+// where an object already copied into the image went
+typedef struct {
+    void *object;
+    uint64_t offset;
+} Placed;
+
+typedef struct {
+    // open-addressing table of the objects placed so far
+    Placed *placed;
+    size_t capacity;
+    size_t count;
+
+    char *data;
+    size_t size;
+    size_t dataCapacity;
+
+    uint64_t *relocations;
+    size_t relocationCapacity;
+
+    uint64_t *primitives;
+    size_t primitiveCount;
+    size_t primitiveCapacity;
+
+    Pending *pending;
+    size_t pendingCount;
+    size_t pendingCapacity;
+
+    // only numbers, strings, symbols, booleans and lists may be saved; they
+    // are packed more tightly, and equal atoms are saved once
+    int dataOnly;
+    size_t alignment;
+    Placed *atoms;
+    size_t atomCapacity;
+    size_t atomCount;
+
+    int failed;
+} Writer;
+
+// make room for needed elements of elementSize in a malloc'd array
+static void *grow(void *array, size_t *capacity, size_t needed, size_t elementSize) {
+    if (needed <= *capacity) {
+        return array;
+    }
+    size_t newCapacity = *capacity ? *capacity * 2 : 64;
+    while (newCapacity < needed) {
+        newCapacity *= 2;
+    }
+    *capacity = newCapacity;
+    return realloc(array, newCapacity * elementSize);
+}
+
+static size_t slotFor(Writer *w, void *object) {
+    uint64_t hash = (uintptr_t)object * 0x9E3779B97F4A7C15u;
+    size_t slot = (hash ^ (hash >> 32)) & (w->capacity - 1);
+    while (w->placed[slot].object != NULL && w->placed[slot].object != object) {
+        slot = (slot + 1) & (w->capacity - 1);
+    }
+    return slot;
+}
+
+static void remember(Writer *w, void *object, uint64_t offset) {
+    if ((w->count + 1) * 2 > w->capacity) {
+        Placed *old = w->placed;
+        size_t oldCapacity = w->capacity;
+
+        w->capacity = oldCapacity ? oldCapacity * 2 : 1024;
+        w->placed = calloc(w->capacity, sizeof(Placed));
+        for (size_t i = 0; i < oldCapacity; i++) {
+            if (old[i].object != NULL) {
+                w->placed[slotFor(w, old[i].object)] = old[i];
+            }
+        }
+        free(old);
+    }
+    size_t slot = slotFor(w, object);
+    w->placed[slot].object = object;
+    w->placed[slot].offset = offset;
+    w->count++;
+}
+
+// hash of an atom's contents, for finding an equal atom saved earlier
+static uint64_t hashAtom(Value *atom) {
+    uint64_t hash = 14695981039346656037u ^ atom->type;
+    if (atom->type == STR_TYPE || atom->type == SYMBOL_TYPE || atom->type == BOOL_TYPE) {
+        for (char *c = atom->s; *c != '\0'; c++) {
+            hash = (hash ^ (unsigned char)*c) * 1099511628211u;
+        }
+    } else if (atom->type == INT_TYPE || atom->type == DOUBLE_TYPE) {
+        uint64_t bits = 0;
+        memcpy(&bits, atom->type == INT_TYPE ? (void *)&atom->i : (void *)&atom->d,
+               atom->type == INT_TYPE ? sizeof(int) : sizeof(double));
+        hash = (hash ^ bits) * 0x9E3779B97F4A7C15u;
+    }
+    return hash ^ (hash >> 29);
+}
+
+static int sameAtom(Value *a, Value *b) {
+    if (a->type != b->type) {
+        return 0;
+    }
+    switch (a->type) {
+        case INT_TYPE:
+            return a->i == b->i;
+        case DOUBLE_TYPE:
+            return !memcmp(&a->d, &b->d, sizeof(double));
+        case STR_TYPE:
+        case SYMBOL_TYPE:
+        case BOOL_TYPE:
+            return !strcmp(a->s, b->s);
+        default:
+            return 1;
+    }
+}
+
+// The slot of the atom equal to atom in the table of saved atoms, or the empty
+// slot where it goes.
+static size_t atomSlot(Writer *w, Value *atom) {
+    size_t slot = hashAtom(atom) & (w->atomCapacity - 1);
+    while (w->atoms[slot].object != NULL && !sameAtom(w->atoms[slot].object, atom)) {
+        slot = (slot + 1) & (w->atomCapacity - 1);
+    }
+    return slot;
+}
+
+static void rememberAtom(Writer *w, Value *atom, uint64_t offset) {
+    if ((w->atomCount + 1) * 2 > w->atomCapacity) {
+        Placed *old = w->atoms;
+        size_t oldCapacity = w->atomCapacity;
+        w->atomCapacity = oldCapacity ? oldCapacity * 2 : 1024;
+        w->atoms = calloc(w->atomCapacity, sizeof(Placed));
+        for (size_t i = 0; i < oldCapacity; i++) {
+            if (old[i].object != NULL) {
+                w->atoms[atomSlot(w, old[i].object)] = old[i];
+            }
+        }
+        free(old);
+    }
+    size_t slot = atomSlot(w, atom);
+    w->atoms[slot].object = atom;
+    w->atoms[slot].offset = offset;
+    w->atomCount++;
+}
+
+// queue the pointer field at offset field for filling in with target's offset
+static void queue(Writer *w, void *target, int kind, uint64_t field) {
+    memset(w->data + field, 0, sizeof(void *));
+    if (target == NULL) {
+        return;
+    }
+    w->pending = grow(w->pending, &w->pendingCapacity, w->pendingCount + 1, sizeof(Pending));
+    w->pending[w->pendingCount].target = target;
+    w->pending[w->pendingCount].kind = kind;
+    w->pending[w->pendingCount].field = field;
+    w->pendingCount++;
+}
+
+// copy size bytes of object to the end of the image, returning its offset
+static uint64_t append(Writer *w, void *object, size_t size) {
+    size_t offset = w->size;
+    size_t end = (offset + size + w->alignment - 1) & ~(w->alignment - 1);
+    w->data = grow(w->data, &w->dataCapacity, end, 1);
+    memset(w->data + offset, 0, end - offset);
+    memcpy(w->data + offset, object, size);
+    w->size = end;
+    return offset;
+}
+
+// make the relocation bitmap at least words long, clearing any new words
+static void reserveBitmap(Writer *w, size_t words) {
+    size_t oldCapacity = w->relocationCapacity;
+    w->relocations = grow(w->relocations, &w->relocationCapacity, words, sizeof(uint64_t));
+    memset(w->relocations + oldCapacity, 0,
+           (w->relocationCapacity - oldCapacity) * sizeof(uint64_t));
+}
+
+// fill in the pointer field at offset field with target, and mark it for
+// relocation
+static void point(Writer *w, uint64_t field, uint64_t target) {
+    memcpy(w->data + field, &target, sizeof(target));
+    size_t word = field / sizeof(uint64_t);
+    reserveBitmap(w, word / 64 + 1);
+    w->relocations[word / 64] |= (uint64_t)1 << (word % 64);
+}
+
+// Copy object into the image unless it's already there, and return its offset.
+// Its pointer fields are queued to be filled in once their targets are placed.
+static uint64_t place(Writer *w, void *object, int kind) {
+    if (w->capacity > 0) {
+        size_t slot = slotFor(w, object);
+        if (w->placed[slot].object == object) {
+            return w->placed[slot].offset;
+        }
+    }
+
+    if (kind == STRING_OBJECT) {
+        uint64_t offset = append(w, object, strlen(object) + 1);
+        remember(w, object, offset);
+        return offset;
+    }
+
+    if (kind == FRAME_OBJECT) {
+        Frame *frame = object;
+        uint64_t offset = append(w, frame, sizeof(Frame));
+        remember(w, object, offset);
+        queue(w, frame->bindings, VALUE_OBJECT, offset + offsetof(Frame, bindings));
+        queue(w, frame->parent, FRAME_OBJECT, offset + offsetof(Frame, parent));
+        return offset;
+    }
+
+    Value *value = object;
+    if (w->dataOnly && value->type != CONS_TYPE) {
+        if (value->type != INT_TYPE && value->type != DOUBLE_TYPE &&
+            value->type != STR_TYPE && value->type != SYMBOL_TYPE &&
+            value->type != BOOL_TYPE && value->type != NULL_TYPE) {
+            w->failed = 1;
+        } else if (w->atomCount > 0 && w->atoms[atomSlot(w, value)].object != NULL) {
+            uint64_t offset = w->atoms[atomSlot(w, value)].offset;
+            remember(w, object, offset);
+            return offset;
+        }
+    }
+    uint64_t offset;
+    if (w->dataOnly && value->type != CONS_TYPE) {
+        offset = append(w, value, ATOM_SIZE);
+        rememberAtom(w, value, offset);
+    } else {
+        offset = append(w, value, valueSize(value));
+    }
+    remember(w, object, offset);
+    switch (value->type) {
+        case INT_TYPE:
+        case DOUBLE_TYPE:
+        case NULL_TYPE:
+        case VOID_TYPE:
+        case EOF_TYPE:
+            break;
+        case STR_TYPE:
+        case SYMBOL_TYPE:
+        case BOOL_TYPE:
+        case OPEN_TYPE:
+        case CLOSE_TYPE:
+            queue(w, value->s, STRING_OBJECT, offset + offsetof(Value, s));
+            break;
+        case CONS_TYPE:
+            // what eval learned about the list may not hold where it's loaded,
+            // but a lambda body stays expanded
+            if (value->quick != QUICK_EXPANDED) {
+                memset(w->data + offset + offsetof(Value, quick), 0, sizeof(value->quick));
+            }
+            queue(w, value->c.car, VALUE_OBJECT, offset + offsetof(Value, c.car));
+            queue(w, value->c.cdr, VALUE_OBJECT, offset + offsetof(Value, c.cdr));
+            break;
+        case CLOSURE_TYPE:
+            queue(w, value->cl.paramNames, VALUE_OBJECT,
+                  offset + offsetof(Value, cl.paramNames));
+            queue(w, value->cl.functionCode, VALUE_OBJECT,
+                  offset + offsetof(Value, cl.functionCode));
+            queue(w, value->cl.frame, FRAME_OBJECT, offset + offsetof(Value, cl.frame));
+            // native code isn't saved; the loaded closure warms up again,
+            // and checks its parameters again on its first call
+            ClosureInfo info = {0, -1, NULL};
+            memcpy(w->data + offset + sizeof(Value), &info, sizeof(info));
+            break;
+        case MACRO_TYPE:
+            queue(w, value->mc.literals, VALUE_OBJECT, offset + offsetof(Value, mc.literals));
+            queue(w, value->mc.rules, VALUE_OBJECT, offset + offsetof(Value, mc.rules));
+            break;
+        case PROMISE_TYPE:
+            queue(w, value->pr.value, VALUE_OBJECT, offset + offsetof(Value, pr.value));
+            queue(w, value->pr.code, VALUE_OBJECT, offset + offsetof(Value, pr.code));
+            queue(w, value->pr.frame, FRAME_OBJECT, offset + offsetof(Value, pr.frame));
+            break;
+        case F64VECTOR_TYPE: {
+            // the elements belong to the vector alone, so they go right after it
+            uint64_t elements = append(w, value->fv.elements,
+                                       value->fv.length * sizeof(double));
+            point(w, offset + offsetof(Value, fv.elements), elements);
+            break;
+        }
+        case UNSPECIFIED_TYPE:
+            queue(w, value->p, VALUE_OBJECT, offset + offsetof(Value, p));
+            break;
+        case PRIMITIVE_TYPE: {
+            char *name = value->primitive->name;
+            memset(w->data + offset + offsetof(Value, primitive), 0, sizeof(void *));
+            uint64_t nameOffset = place(w, name, STRING_OBJECT);
+            w->primitives = grow(w->primitives, &w->primitiveCapacity,
+                                 w->primitiveCount + 2, sizeof(uint64_t));
+            w->primitives[w->primitiveCount++] = offset + offsetof(Value, primitive);
+            w->primitives[w->primitiveCount++] = nameOffset;
+            break;
+        }
+        default:
+            w->failed = 1;
+            break;
+    }
+    return offset;
+}
+
+// Save root, an object of the given kind, and everything reachable from it to
+// path, tagged with key. Pointers are laid out for the objects to start at the
+// address baseFor picks for the path and the length of the file, or at 0 if
+// baseFor is NULL. Returns 0 on success, 2 if root reaches something that
+// can't be saved and 1 if the file can't be written.
+static int saveGraph(char *path, void *root, int kind, uint64_t key,
+                     uint64_t (*baseFor)(char *path, uint64_t length), int dataOnly) {
+    Writer w;
+    memset(&w, 0, sizeof(w));
+    w.dataOnly = dataOnly;
+    w.alignment = dataOnly ? sizeof(void *) : IMAGE_ALIGNMENT;
+
+    // offset 0 stands for NULL, so the first object goes after some padding
+    char padding[IMAGE_ALIGNMENT] = {0};
+    append(&w, padding, IMAGE_ALIGNMENT);
+    uint64_t rootOffset = place(&w, root, kind);
+
+    while (w.pendingCount > 0) {
+        Pending next = w.pending[--w.pendingCount];
+        point(&w, next.field, place(&w, next.target, next.kind));
+    }
+    if (dataOnly) {
+        Value padding;
+        memset(&padding, 0, sizeof(padding));
+        append(&w, &padding, sizeof(padding));
+    }
+
+    ImageHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, IMAGE_MAGIC, 8);
+    header.valueSize = sizeof(Value);
+    header.frameSize = sizeof(Frame);
+    header.key = key;
+    header.size = w.size;
+    header.root = rootOffset;
+    header.relocations = (w.size / sizeof(uint64_t) + 63) / 64;
+    reserveBitmap(&w, header.relocations);
+    header.primitives = w.primitiveCount / 2;
+    uint64_t length = sizeof(header) + w.size +
+                      (header.relocations + w.primitiveCount) * sizeof(uint64_t);
+    uint64_t base = baseFor == NULL ? 0 : baseFor(path, length);
+    header.base = base;
+    if (base != 0) {
+        for (uint64_t i = 0; i < header.relocations; i++) {
+            for (uint64_t bits = w.relocations[i]; bits != 0; bits &= bits - 1) {
+                uint64_t *field = (uint64_t *)w.data + i * 64 + __builtin_ctzll(bits);
+                *field += base;
+            }
+        }
+    }
+
+    // write next to the destination and rename, so readers never see half a file
+    int status = w.failed ? 2 : 1;
+    char *temporary = malloc(strlen(path) + 5);
+    sprintf(temporary, "%s.tmp", path);
+    FILE *out = w.failed ? NULL : fopen(temporary, "wb");
+    if (out != NULL) {
+        int ok = fwrite(&header, sizeof(header), 1, out) == 1 &&
+                 fwrite(w.data, 1, w.size, out) == w.size &&
+                 fwrite(w.relocations, sizeof(uint64_t), header.relocations, out) ==
+                     header.relocations &&
+                 (w.primitiveCount == 0 ||
+                  fwrite(w.primitives, sizeof(uint64_t), w.primitiveCount, out) ==
+                      w.primitiveCount);
+        status = (fclose(out) != 0 || !ok || rename(temporary, path) != 0);
+        if (status != 0) {
+            remove(temporary);
+        }
+    }
+    free(temporary);
+
+    free(w.placed);
+    free(w.atoms);
+    free(w.data);
+    free(w.relocations);
+    free(w.primitives);
+    free(w.pending);
+    return status;
+}
+
+// Map a file written by saveGraph back into memory and relocate it. Returns its
+// root, or NULL unless the file is usable and was saved with key. A read-only
+// graph is first tried at the address it was laid out for, where it needs no
+// relocating and its pages stay shared with the page cache; elsewhere it is
+// relocated and then write-protected.
+static void *loadGraph(char *path, int kind, uint64_t key, int readOnly) {
+    size_t rootSize = kind == FRAME_OBJECT ? sizeof(Frame) : sizeof(Value);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat info;
+    ImageHeader peek;
+    if (fstat(fd, &info) < 0 || (size_t)info.st_size < sizeof(ImageHeader) ||
+        pread(fd, &peek, sizeof(peek), 0) != sizeof(peek)) {
+        close(fd);
+        return NULL;
+    }
+    size_t length = info.st_size;
+    char *map = MAP_FAILED;
+    if (readOnly && peek.base > sizeof(ImageHeader)) {
+        char *wanted = (char *)(uintptr_t)(peek.base - sizeof(ImageHeader));
+        map = mmap(wanted, length, PROT_READ, MAP_PRIVATE | MAP_FIXED_NOREPLACE, fd, 0);
+        if (map != MAP_FAILED && map != wanted) {
+            munmap(map, length);
+            map = MAP_FAILED;
+        }
+    }
+    int placed = map != MAP_FAILED;
+    if (!placed) {
+        map = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (map == MAP_FAILED) {
+        return NULL;
+    }
+
+    ImageHeader *header = (ImageHeader *)map;
+    char *base = map + sizeof(ImageHeader);
+    uint64_t *relocations = (uint64_t *)(base + header->size);
+    uint64_t *primitives = relocations + header->relocations;
+
+    // the objects, the bitmap and the primitive table have to fit in the
+    // file, the bitmap has to have exactly one bit per word of the objects,
+    // and the root has to be one of them
+    size_t tables = (length - sizeof(ImageHeader)) / sizeof(uint64_t);
+    if (memcmp(header->magic, IMAGE_MAGIC, 8) != 0 ||
+        header->valueSize != sizeof(Value) || header->frameSize != sizeof(Frame) ||
+        header->key != key ||
+        header->size > length - sizeof(ImageHeader) ||
+        header->size % sizeof(uint64_t) != 0 ||
+        header->relocations != (header->size / sizeof(uint64_t) + 63) / 64 ||
+        header->primitives > tables ||
+        header->relocations + 2 * header->primitives >
+            tables - header->size / sizeof(uint64_t) ||
+        header->size < rootSize || header->root > header->size - rootSize ||
+        (readOnly && header->primitives != 0)) {
+        munmap(map, length);
+        return NULL;
+    }
+
+    // every pointer field has to be inside the objects and point into them
+    uintptr_t delta = (uintptr_t)base - header->base;
+    uint64_t words = header->size / sizeof(uint64_t);
+    for (uint64_t i = 0; i < header->relocations; i++) {
+        for (uint64_t bits = relocations[i]; bits != 0; bits &= bits - 1) {
+            uint64_t word = i * 64 + __builtin_ctzll(bits);
+            uintptr_t *field = (uintptr_t *)base + word;
+            if (word >= words || *field - header->base >= header->size) {
+                munmap(map, length);
+                return NULL;
+            }
+            if (!placed) {
+                *field += delta;
+            }
+        }
+    }
+    if (placed) {
+        return base + header->root;
+    }
+
+    for (uint64_t i = 0; i < header->primitives; i++) {
+        uint64_t field = primitives[2 * i];
+        uint64_t name = primitives[2 * i + 1];
+        Primitive *primitive = NULL;
+        if (field <= header->size - sizeof(primitive) && name < header->size &&
+            memchr(base + name, '\0', header->size - name) != NULL) {
+            primitive = findPrimitive(base + name);
+        }
+        if (primitive == NULL) {
+            munmap(map, length);
+            return NULL;
+        }
+        memcpy(base + field, &primitive, sizeof(primitive));
+    }
+
+    if (readOnly) {
+        mprotect(map, length, PROT_READ);
+    }
+    return base + header->root;
+}
+
+// Save frame, and everything reachable from it, to an image file at path.
+int writeImage(char *path, Frame *frame) {
+    return saveGraph(path, frame, FRAME_OBJECT, 0, NULL, 0);
+}
+
+// Map an image written by writeImage back into memory, relocate it, and return
+// its frame; NULL if the file is missing or isn't a usable image.
+Frame *readImage(char *path) {
+    return loadGraph(path, FRAME_OBJECT, 0, 0);
+}
+
+// Save a parse tree to path, tagged with key.
+int writeTree(char *path, Value *tree, uint64_t key) {
+    return saveGraph(path, tree, VALUE_OBJECT, key, NULL, 0);
+}
+
+// Map a parse tree saved by writeTree back in, or NULL if path doesn't hold
+// one saved with key.
+Value *readTree(char *path, uint64_t key) {
+    return loadGraph(path, VALUE_OBJECT, key, 0);
+}
+
+// Where a datum file of length bytes saved to path is laid out to start: in
+// the slots from the one its path hashes to on, chosen so that they all lie
+// inside the area. A file too big for the whole area gets 0 and is always
+// relocated.
+static uint64_t datumBase(char *path, uint64_t length) {
+    uint64_t slots = (length + (1ull << 30) - 1) >> 30;
+    if (slots > DATUM_SLOTS) {
+        return 0;
+    }
+    uint64_t hash = 14695981039346656037u;
+    for (char *c = path; *c != '\0'; c++) {
+        hash = (hash ^ (unsigned char)*c) * 1099511628211u;
+    }
+    return DATUM_AREA + ((hash % (DATUM_SLOTS - slots + 1)) << 30) + sizeof(ImageHeader);
+}
+
+// Save datum, which may only hold numbers, strings, symbols, booleans and
+// lists, to path, laid out for the slots its path hashes to.
+int writeDatum(char *path, Value *datum) {
+    return saveGraph(path, datum, VALUE_OBJECT, DATUM_KEY, datumBase, 1);
+}
+
+// a datum file already mapped, and the file it was mapped from
+typedef struct Loaded {
+    dev_t device;
+    ino_t inode;
+    struct timespec modified;
+    off_t size;
+    Value *datum;
+    struct Loaded *next;
+} Loaded;
+
+static Loaded *loaded;
+static pthread_mutex_t loadedLock = PTHREAD_MUTEX_INITIALIZER;
+
+// Map a datum saved by writeDatum, read-only, or NULL if path doesn't hold
+// one. Loading a file again while it is unchanged gives the same datum.
+Value *readDatum(char *path) {
+    struct stat info;
+    if (stat(path, &info) < 0) {
+        return NULL;
+    }
+    // the data is read-only, so threads share it
+    pthread_mutex_lock(&loadedLock);
+    for (Loaded *l = loaded; l != NULL; l = l->next) {
+        if (l->device == info.st_dev && l->inode == info.st_ino &&
+            l->size == info.st_size && l->modified.tv_sec == info.st_mtim.tv_sec &&
+            l->modified.tv_nsec == info.st_mtim.tv_nsec) {
+            pthread_mutex_unlock(&loadedLock);
+            return l->datum;
+        }
+    }
+    Value *datum = loadGraph(path, VALUE_OBJECT, DATUM_KEY, 1);
+    if (datum != NULL) {
+        Loaded *l = malloc(sizeof(Loaded));
+        l->device = info.st_dev;
+        l->inode = info.st_ino;
+        l->modified = info.st_mtim;
+        l->size = info.st_size;
+        l->datum = datum;
+        l->next = loaded;
+        loaded = l;
+    }
+    pthread_mutex_unlock(&loadedLock);
+    return datum;
+}
@@ -0,0 +1,37 @@
+#include <stdint.h>
+#include "value.h"
+
+#ifndef _IMAGE
+#define _IMAGE
+
+// Save frame, and everything reachable from it, to an image file at path.
+// Objects are laid out as they are in memory, with pointers replaced by
+// offsets into the image. Returns 0 on success.
+int writeImage(char *path, Frame *frame);
+
+// Map an image written by writeImage back into memory, relocate it, and return
+// its frame; NULL if the file is missing or isn't a usable image. The mapping
+// stays in place until the program ends.
+Frame *readImage(char *path);
+
+// Save a parse tree to path in the same format, tagged with key (such as a
+// hash of the source it came from). Returns 0 on success.
+int writeTree(char *path, Value *tree, uint64_t key);
+
+// Map a parse tree saved by writeTree back in, or NULL if path doesn't hold
+// one saved with key.
+Value *readTree(char *path, uint64_t key);
+
+// Save a datum made of numbers, strings, symbols, booleans and lists to path
+// in the same format, laid out for a fixed address. The cells are stored as
+// they are used, so the file runs to about five times the size of the text
+// in exchange for loading without decoding. Returns 0 on success, 2 if the
+// datum holds anything else and 1 if the file can't be written.
+int writeDatum(char *path, Value *datum);
+
+// Map a datum saved by writeDatum back in, read-only, or NULL if path doesn't
+// hold one. When its address is free the file is used where it was mapped,
+// without relocating or copying any of it.
+Value *readDatum(char *path);
+
+#endif
@@ -2,43 +2,87 @@
 #include "talloc.h"
 #include "interpreter.h"
 #include "parser.h"
+#include "jit.h"
+#include "output.h"
+#include "f64vector.h"
+#include "tokenizer.h"
+#include "port.h"
+#include "load.h"
+#include "expand.h"
+#include "promote.h"
+#include "governor.h"
+#include "profile.h"
+#include "image.h"
+#include "quicken.h"
+#include "source.h"
+#include "actor.h"
+#include "task.h"
+#include "sort.h"
 #include <string.h>
 #include <stdio.h>
 
+// when set, set! may only modify bindings allocated in this region
+static __thread Region *setRegion;
+
+// the frame the top-level forms of the program (or actor) are evaluated in,
+// which load evaluates files into
+static __thread Frame *topFrame;
+
+// where the bodies of lambda forms that talloc didn't allocate (those of
+// mapped images and trees, which are never unmapped) are expanded into
+static __thread Region *mappedExpansions;
+
 // take in a value that is not a cons cell and print it
 void printValue(Value *value) {
     switch (value->type) {
         case INT_TYPE:
-            printf("%i\n", value->i);
+            outputInt(value->i);
+            outputChar('\n');
             break;
         case BOOL_TYPE:
-            printf("%s\n", value->s);
-            break;
-        case DOUBLE_TYPE:
-            printf("%f\n", value->d);
-            break;
         case STR_TYPE:
-            printf("%s\n", value->s);
-            break;
         case SYMBOL_TYPE:
-            printf("%s\n", value->s);
+            outputString(value->s);
+            outputChar('\n');
+            break;
+        case DOUBLE_TYPE:
+            outputDouble(value->d);
+            outputChar('\n');
             break;
         case CONS_TYPE:
-            printf("(");
+            outputChar('(');
             printTree(value);
-            printf(")\n");
+            outputString(")\n");
             break;
         case NULL_TYPE:
-            printf("(");
-            printf(")\n");
+            outputString("()\n");
             break;
         case CLOSURE_TYPE:
-            printf("#<procedure>\n");
+            outputString("#<procedure>\n");
+            break;
+        case PROMISE_TYPE:
+            outputString("#<promise>\n");
+            break;
+        case F64VECTOR_TYPE:
+            printVector(value);
+            outputChar('\n');
+            break;
+        case PORT_TYPE:
+            outputString("#<port>\n");
+            break;
+        case EOF_TYPE:
+            outputString("#<eof>\n");
+            break;
+        case MACRO_TYPE:
+            outputString("#<macro>\n");
+            break;
+        case ACTOR_TYPE:
+            outputString("#<actor>\n");
             break;
         case VOID_TYPE:
             break;
         default:
-            printf("Oops not printable!\n");
+            outputString("Oops not printable!\n");
             break;
     }
     return;
@@ -47,54 +91,57 @@ void printValue(Value *value) {
 // PRIMITIVES
 
 // primitive function for +
-Value *primitiveAdd(Value *args) {
+Value *primitiveAdd(int argc, Value **argv) {
     
     int isDouble = 0;
-    float sum = 0;
+    double sum = 0;
+    unsigned int intSum = 0; // integer sums wrap around like machine arithmetic
 
     // loop throgh args
-    while (!isNull(args)) {
-        Value *cur = car(args);
+    for (int i = 0; i < argc; i++) {
+        Value *cur = argv[i];
         if (cur->type == DOUBLE_TYPE) {
             isDouble = 1;
             sum += cur->d;
         } else if (cur->type == INT_TYPE) {
             sum += cur->i;
+            intSum += cur->i;
         } else {
             printf("Evaluation error: '+' has invalid argument(s).\n");
             texit(1);
         }
-        args = cdr(args);
     }
     
     // make result Value
-    Value *result = talloc(sizeof(Value));
+    Value *result = tallocKind(sizeof(Value), NUMBER_MEMORY);
     if (isDouble) {
         result->type = DOUBLE_TYPE;
         result->d = sum;
     } else {
         result->type = INT_TYPE;
-        result->i = (int) sum;
+        result->i = (int) intSum;
     }
     return result;
 }
 
-// primitive function for null?
-Value *primitiveNull(Value *args) {
-
-    if (isNull(args)) {
-        printf("Evaluation error: no argument supplied to 'null?'\n");
-        texit(1);
+// + on exactly two arguments, without the loop for the common case of two
+// integers
+Value *primitiveAdd2(int argc, Value **argv) {
+    if (argv[0]->type != INT_TYPE || argv[1]->type != INT_TYPE) {
+        return primitiveAdd(argc, argv);
     }
+    Value *result = tallocKind(sizeof(Value), NUMBER_MEMORY);
+    result->type = INT_TYPE;
+    result->i = (int) ((unsigned int) argv[0]->i + (unsigned int) argv[1]->i);
+    return result;
+}
 
-    if (!isNull(cdr(args))){
-        printf("Evaluation error: too many arguments supplied to 'null?'\n");
-        texit(1);
-    }
+// primitive function for null?
+Value *primitiveNull(int argc, Value **argv) {
 
     Value* result = talloc(sizeof(Value));
     result->type = BOOL_TYPE;
-    if (isNull(car(args))) {
+    if (isNull(argv[0])) {
         result->s = "#t";
     } else {
         result->s = "#f";
@@ -103,71 +150,56 @@ Value *primitiveNull(Value *args) {
 }
 
 // primitive function for cons
-Value *primitiveCons(Value *args){
+Value *primitiveCons(int argc, Value **argv) {
 
-    if (isNull(args) || isNull(car(args)) || isNull(cdr(args))){
+    if (isNull(argv[0])){
         printf("Evaluation error: insufficient amount of arguments supplied to cons\n");
         texit(1);
     }
 
-    if (!isNull(cdr(cdr(args)))){
-        printf("Evaluation error: too many arguments supplied to cons\n");
-        texit(1);
-    }
-
-    return cons(car(args), car(cdr(args)));
+    return cons(argv[0], argv[1]);
     
 }
 
 // primitive function for cdr
-Value *primitiveCdr(Value *args){
+Value *primitiveCdr(int argc, Value **argv) {
 
-    if (isNull(args) || isNull(car(args))) {
+    if (isNull(argv[0])) {
         printf("Evaluation error: no argument supplied to cdr\n");
         texit(1);
     }
+    if(argv[0]->type != CONS_TYPE){
+        printf("Evaluation error: incorrect argument type supplied to cdr\n");
+        texit(1);
+    }
 
-    return cdr(car(args));
+    return cdr(argv[0]);
 
 }
 
 // primitive function for car
-Value *primitiveCar(Value *args){
+Value *primitiveCar(int argc, Value **argv) {
     
-    if (isNull(args) || isNull(car(args))){
+    if (isNull(argv[0])){
         printf("Evaluation error: no argument supplied to car\n");
         texit(1);
     }
-    if(car(args)->type != CONS_TYPE){
+    if(argv[0]->type != CONS_TYPE){
         printf("Evaluation error: incorrect argument type supplied to car\n");
         texit(1);
     }
-    if(!isNull(cdr(args))){
-         printf("Evaluation error: too many arguments supplied to car\n");
-         texit(1);
-    }
     
-    return (car(car(args)));
+    return (car(argv[0]));
 }
 
 // primitive function for -
-Value *primitiveMinus(Value *args) {
-
-    if (isNull(args) || isNull(car(args)) || isNull(cdr(args))){
-        printf("Evaluation error: insufficient amount of arguments supplied to '-'\n");
-        texit(1);
-    }
+Value *primitiveMinus(int argc, Value **argv) {
 
-    if (!isNull(cdr(cdr(args)))){
-        printf("Evaluation error: too many arguments supplied to '-'\n");
-        texit(1);
-    }
-
-    Value* first = car(args);
-    Value* second = car(cdr(args));
+    Value* first = argv[0];
+    Value* second = argv[1];
 
     // make result Value
-    Value *result = talloc(sizeof(Value));
+    Value *result = tallocKind(sizeof(Value), NUMBER_MEMORY);
 
     if (first->type == DOUBLE_TYPE && second->type == DOUBLE_TYPE) {
         result->type = DOUBLE_TYPE;
@@ -190,21 +222,11 @@ Value *primitiveMinus(Value *args) {
 }
 
 // primitive function for <
-Value *primitiveSmaller(Value *args) {
+Value *primitiveSmaller(int argc, Value **argv) {
 
-    if (isNull(args) || isNull(car(args)) || isNull(cdr(args))){
-        printf("Evaluation error: insufficient amount of arguments supplied to '<'\n");
-        texit(1);
-    }
-
-    if (!isNull(cdr(cdr(args)))){
-        printf("Evaluation error: too many arguments supplied to '<'\n");
-        texit(1);
-    }
-
-    Value* first = car(args);
-    Value* second = car(cdr(args));
-    float firstnumber, secondnumber;
+    Value* first = argv[0];
+    Value* second = argv[1];
+    double firstnumber, secondnumber;
 
     // make result Value
     Value *result = talloc(sizeof(Value));
@@ -214,14 +236,14 @@ Value *primitiveSmaller(Value *args) {
         firstnumber = first->d;
         secondnumber = second->d;
     } else if (first->type == INT_TYPE && second->type == DOUBLE_TYPE) {
-        firstnumber = (float) first->i;
+        firstnumber = (double) first->i;
         secondnumber = second->d;
     } else if (first->type == DOUBLE_TYPE && second->type == INT_TYPE) {
         firstnumber = first->d;
-        secondnumber = (float) second->i;
+        secondnumber = (double) second->i;
     } else if (first->type == INT_TYPE && second->type == INT_TYPE) {
-        firstnumber = (float) first->i;
-        secondnumber = (float) second->i;
+        firstnumber = (double) first->i;
+        secondnumber = (double) second->i;
     } else {
         printf("Evaluation error: '<' has invalid argument(s).\n");
         texit(1);
@@ -236,21 +258,11 @@ Value *primitiveSmaller(Value *args) {
 }
 
 // primitive function for >
-Value *primitiveLarger(Value *args) {
-
-    if (isNull(args) || isNull(car(args)) || isNull(cdr(args))){
-        printf("Evaluation error: insufficient amount of arguments supplied to '<'\n");
-        texit(1);
-    }
-
-    if (!isNull(cdr(cdr(args)))){
-        printf("Evaluation error: too many arguments supplied to '<'\n");
-        texit(1);
-    }
+Value *primitiveLarger(int argc, Value **argv) {
 
-    Value* first = car(args);
-    Value* second = car(cdr(args));
-    float firstnumber, secondnumber;
+    Value* first = argv[0];
+    Value* second = argv[1];
+    double firstnumber, secondnumber;
 
     // make result Value
     Value *result = talloc(sizeof(Value));
@@ -260,14 +272,14 @@ Value *primitiveLarger(Value *args) {
         firstnumber = first->d;
         secondnumber = second->d;
     } else if (first->type == INT_TYPE && second->type == DOUBLE_TYPE) {
-        firstnumber = (float) first->i;
+        firstnumber = (double) first->i;
         secondnumber = second->d;
     } else if (first->type == DOUBLE_TYPE && second->type == INT_TYPE) {
         firstnumber = first->d;
-        secondnumber = (float) second->i;
+        secondnumber = (double) second->i;
     } else if (first->type == INT_TYPE && second->type == INT_TYPE) {
-        firstnumber = (float) first->i;
-        secondnumber = (float) second->i;
+        firstnumber = (double) first->i;
+        secondnumber = (double) second->i;
     } else {
         printf("Evaluation error: '<' has invalid argument(s).\n");
         texit(1);
@@ -282,21 +294,11 @@ Value *primitiveLarger(Value *args) {
 }
 
 // primitive function for =
-Value *primitiveEqual(Value *args) {
-
-    if (isNull(args) || isNull(car(args)) || isNull(cdr(args))){
-        printf("Evaluation error: insufficient amount of arguments supplied to '<'\n");
-        texit(1);
-    }
-
-    if (!isNull(cdr(cdr(args)))){
-        printf("Evaluation error: too many arguments supplied to '<'\n");
-        texit(1);
-    }
+Value *primitiveEqual(int argc, Value **argv) {
 
-    Value* first = car(args);
-    Value* second = car(cdr(args));
-    float firstnumber, secondnumber;
+    Value* first = argv[0];
+    Value* second = argv[1];
+    double firstnumber, secondnumber;
 
     // make result Value
     Value *result = talloc(sizeof(Value));
@@ -306,14 +308,14 @@ Value *primitiveEqual(Value *args) {
         firstnumber = first->d;
         secondnumber = second->d;
     } else if (first->type == INT_TYPE && second->type == DOUBLE_TYPE) {
-        firstnumber = (float) first->i;
+        firstnumber = (double) first->i;
         secondnumber = second->d;
     } else if (first->type == DOUBLE_TYPE && second->type == INT_TYPE) {
         firstnumber = first->d;
-        secondnumber = (float) second->i;
+        secondnumber = (double) second->i;
     } else if (first->type == INT_TYPE && second->type == INT_TYPE) {
-        firstnumber = (float) first->i;
-        secondnumber = (float) second->i;
+        firstnumber = (double) first->i;
+        secondnumber = (double) second->i;
     } else {
         printf("Evaluation error: '<' has invalid argument(s).\n");
         texit(1);
@@ -328,56 +330,59 @@ Value *primitiveEqual(Value *args) {
 }
 
 // primitive function for *
-Value *primitiveMultiply(Value *args) {
+Value *primitiveMultiply(int argc, Value **argv) {
     
     int isDouble = 0;
-    float product = 1;
+    double product = 1;
+    unsigned int intProduct = 1; // integer products wrap around like machine arithmetic
 
     // loop throgh args
-    while (!isNull(args)) {
-        Value *cur = car(args);
+    for (int i = 0; i < argc; i++) {
+        Value *cur = argv[i];
         if (cur->type == DOUBLE_TYPE) {
             isDouble = 1;
             product *= cur->d;
         } else if (cur->type == INT_TYPE) {
             product *= cur->i;
+            intProduct *= cur->i;
         } else {
             printf("Evaluation error: '+' has invalid argument(s).\n");
             texit(1);
         }
-        args = cdr(args);
     }
     
     // make result Value
-    Value *result = talloc(sizeof(Value));
+    Value *result = tallocKind(sizeof(Value), NUMBER_MEMORY);
     if (isDouble) {
         result->type = DOUBLE_TYPE;
         result->d = product;
     } else {
         result->type = INT_TYPE;
-        result->i = (int) product;
+        result->i = (int) intProduct;
     }
     return result;
 }
 
-// primitive function for /
-Value *primitiveDivide(Value *args) {
-
-    if (isNull(args) || isNull(car(args)) || isNull(cdr(args))){
-        printf("Evaluation error: insufficient amount of arguments supplied to '/'\n");
-        texit(1);
+// * on exactly two arguments, without the loop for the common case of two
+// integers
+Value *primitiveMultiply2(int argc, Value **argv) {
+    if (argv[0]->type != INT_TYPE || argv[1]->type != INT_TYPE) {
+        return primitiveMultiply(argc, argv);
     }
+    Value *result = tallocKind(sizeof(Value), NUMBER_MEMORY);
+    result->type = INT_TYPE;
+    result->i = (int) ((unsigned int) argv[0]->i * (unsigned int) argv[1]->i);
+    return result;
+}
 
-    if (!isNull(cdr(cdr(args)))){
-        printf("Evaluation error: too many arguments supplied to '/'\n");
-        texit(1);
-    }
+// primitive function for /
+Value *primitiveDivide(int argc, Value **argv) {
 
-    Value* first = car(args);
-    Value* second = car(cdr(args));
+    Value* first = argv[0];
+    Value* second = argv[1];
 
     // make result Value
-    Value *result = talloc(sizeof(Value));
+    Value *result = tallocKind(sizeof(Value), NUMBER_MEMORY);
 
     if (first->type == DOUBLE_TYPE && second->type == DOUBLE_TYPE) {
         result->type = DOUBLE_TYPE;
@@ -394,7 +399,7 @@ Value *primitiveDivide(Value *args) {
             result->i = first->i / second->i;
         } else {
             result->type = DOUBLE_TYPE;
-            result->d = (float) first->i / second->i;
+            result->d = (double) first->i / second->i;
         }
     } else {
         printf("Evaluation error: '/' has invalid argument(s).\n");
@@ -405,23 +410,13 @@ Value *primitiveDivide(Value *args) {
 }
 
 // primitive function for modulo
-Value *primitiveModulo(Value *args) {
-
-    if (isNull(args) || isNull(car(args)) || isNull(cdr(args))){
-        printf("Evaluation error: insufficient amount of arguments supplied to 'modulo'\n");
-        texit(1);
-    }
-
-    if (!isNull(cdr(cdr(args)))){
-        printf("Evaluation error: too many arguments supplied to 'modulo'\n");
-        texit(1);
-    }
+Value *primitiveModulo(int argc, Value **argv) {
 
-    Value* first = car(args);
-    Value* second = car(cdr(args));
+    Value* first = argv[0];
+    Value* second = argv[1];
 
     // make result Value
-    Value *result = talloc(sizeof(Value));
+    Value *result = tallocKind(sizeof(Value), NUMBER_MEMORY);
 
     if (first->type == INT_TYPE && second->type == INT_TYPE) {
         result->type = INT_TYPE;
@@ -435,16 +430,16 @@ Value *primitiveModulo(Value *args) {
 }
 
 // add the symbol-primitive binding to frame
-void bind(char *name, Value *(*function)(struct Value *), Frame *frame) {
+void bindPrimitive(Primitive *primitive, Frame *frame) {
     // Add primitive functions to top-level bindings list
     Value *value = talloc(sizeof(Value));
     value->type = PRIMITIVE_TYPE;
-    value->pf = function;
+    value->primitive = primitive;
 
     Value *symbol = talloc(sizeof(Value));
     symbol->type = SYMBOL_TYPE;
-    symbol->s = talloc(strlen(name) + 1);
-    strcpy(symbol->s, name);
+    symbol->s = talloc(strlen(primitive->name) + 1);
+    strcpy(symbol->s, primitive->name);
 
     Value* binding = cons(symbol, value);
 
@@ -500,10 +495,13 @@ Value *evalDefine(Value *args, Frame *frame) {
     }
 
     // make binding
+    noteBinding(variable->s);
     Value *binding = cons(variable, eval(value, frame));
 
     // insert binding
     frame->bindings = cons(binding, frame->bindings);
+    noteRebinding();
+    rememberFrame(frame);
 
     Value *result = talloc(sizeof(Value));
     result->type = VOID_TYPE;
@@ -529,9 +527,76 @@ Value *evalLambda(Value *args, Frame *frame) {
         texit(1);
     }
 
-    // checking params validity
-    Value *params = car(args);
-    curr = params;
+    // create closure; its parameters are checked and its body expanded when
+    // it is first applied, so closures that are never called cost nothing
+    // more than this
+    Value *closure = tallocKind(CLOSURE_SIZE, CLOSURE_MEMORY);
+    closure->type = CLOSURE_TYPE;
+    closure->cl.paramNames = car(args);
+    closure->cl.functionCode = cdr(args);
+    closure->cl.frame = frame;
+    ClosureInfo *info = closureInfo(closure);
+    info->calls = 0;
+    info->arity = -1;
+    info->native = NULL;
+
+    return closure;
+}
+
+// Expand the body of closure, which is being applied for the first time,
+// unless its lambda form was expanded already. The expansion goes back into
+// the form, allocated in the region the form is in, so that it lives as long
+// as the form and the other closures the form makes find it done. A form from
+// outside the memory of a program run by the server may be shared with other
+// programs, which may have macros of their own, so its expansion only goes to
+// the closure, in a (body) list of its own.
+static void expandClosureBody(Value *closure) {
+    Value *rest = closure->cl.functionCode;
+    if (rest->quick == QUICK_EXPANDED) {
+        return;
+    }
+    int shared = setRegion != NULL && !inRegion(rest, setRegion) && !inForm(rest);
+    Region *owner = regionOf(shared ? closure : rest);
+    if (owner == NULL) {
+        if (mappedExpansions == NULL) {
+            mappedExpansions = newRegion();
+        }
+        owner = mappedExpansions;
+    }
+
+    // an error in a macro use mustn't leave the owner's region current
+    Region *previous = useRegion(owner);
+    jmp_buf recovery;
+    jmp_buf *outer = setRecovery(&recovery);
+    int failed = setjmp(recovery);
+    Value *body = NULL;
+    if (!failed) {
+        body = expandBody(car(rest), closure->cl.frame);
+        if (shared && body != car(rest)) {
+            closure->cl.functionCode = cons(body, makeNull());
+            closure->cl.functionCode->quick = QUICK_EXPANDED;
+        }
+    }
+    setRecovery(outer);
+    useRegion(previous);
+    if (failed) {
+        texit(failed);
+    }
+    if (!shared) {
+        if (body != car(rest)) {
+            rest->c.car = body;
+        }
+        rest->quick = QUICK_EXPANDED;
+    }
+}
+
+// Check the parameters of a closure that is being applied for the first time
+// and record how many there are, expanding its body unless that was done
+// already.
+static void analyzeClosure(Value *closure) {
+    expandClosureBody(closure);
+    Value *curr = closure->cl.paramNames;
+    int count = 0;
     while (!isNull(curr)) {
         if (car(curr)->type != SYMBOL_TYPE) {
             printf("Evaluation error: 'lambda' has invalid params.\n");
@@ -545,36 +610,28 @@ Value *evalLambda(Value *args, Frame *frame) {
             }
             next = cdr(next);
         }
+        noteBinding(car(curr)->s);
+        count++;
         curr = cdr(curr);
     }
-
-    // create closure
-    Value *closure = talloc(sizeof(Value));
-    closure->type = CLOSURE_TYPE;
-    closure->cl.paramNames = params;
-    closure->cl.functionCode = car(cdr(args));
-    closure->cl.frame = frame;
-
-    return closure;
-}
-
-// eval all arguments for special form functions
-Value *evalEach(Value *args, Frame *frame) {
-    
-    Value *evaluated = makeNull();
-    while (!isNull(args)) {
-        evaluated = cons(eval(car(args), frame), evaluated);
-        args = cdr(args);
-    }
-    evaluated = reverse(evaluated);
-    return evaluated;
+    closureInfo(closure)->arity = count;
 }
 
-// apply the special form funtion to the evaluated args
-Value *apply(Value *function, Value *args){
+// Apply function to the argc evaluated arguments in argv. Primitives get the
+// array itself, so calling one allocates nothing for its arguments.
+Value *applyArray(Value *function, int argc, Value **argv) {
 
     if (function->type == PRIMITIVE_TYPE) { 
-        return function->pf(args);
+        Primitive *primitive = function->primitive;
+        if (argc == 2 && primitive->binary != NULL) {
+            return primitive->binary(argc, argv);
+        }
+        if (primitive->arity >= 0 && argc != primitive->arity) {
+            printf("Evaluation error: '%s' takes exactly %i argument(s).\n",
+                   primitive->name, primitive->arity);
+            texit(1);
+        }
+        return primitive->function(argc, argv);
     }
     
     if (function->type != CLOSURE_TYPE) {
@@ -582,30 +639,55 @@ Value *apply(Value *function, Value *args){
         texit(1);
     }
 
-    Frame *frame = talloc(sizeof(Frame));
+    ClosureInfo *info = closureInfo(function);
+    if (info->arity < 0) {
+        analyzeClosure(function);
+    }
+    if (argc != info->arity) {
+        printf("Evaluation error: wrong number of arguments for function.\n");
+        texit(1);
+    }
+
+    // hot closures get compiled, and run natively while their arguments suit
+    if (info->native == NULL && ++info->calls >= JIT_THRESHOLD) {
+        info->native = compileClosure(function);
+    }
+    if (info->native != NULL && !isGoverned()) {
+        Value *result = runNative(function, argc, argv);
+        if (result != NULL) {
+            return result;
+        }
+    }
+
+    Frame *frame = tallocKind(sizeof(Frame), FRAME_MEMORY);
     frame->parent = function->cl.frame;
     frame->bindings = makeNull();
 
     Value *func_args = function->cl.paramNames;
 
     // match arguments and put into frame
-    while (!isNull(func_args) && !isNull(args)) {
-        Value *binding = cons(car(func_args), car(args));
+    for (int i = 0; i < argc; i++) {
+        Value *binding = cons(car(func_args), argv[i]);
         frame->bindings = cons(binding, frame->bindings);
         func_args = cdr(func_args);
-        args = cdr(args);
     }
 
-    // error checking: # of args
-    if (!isNull(func_args) || !isNull(args)) {
-        printf("Evaluation error: wrong number of arguments for function.\n");
-        texit(1);
-    };
-
-    Value *result = eval(function->cl.functionCode, frame);
+    enterCall();
+    Value *result = eval(car(function->cl.functionCode), frame);
+    leaveCall();
     return result;
 }
 
+// apply the special form funtion to the evaluated args
+Value *apply(Value *function, Value *args){
+    Value *argv[length(args) + 1];
+    int argc = 0;
+    for (; !isNull(args); args = cdr(args)) {
+        argv[argc++] = car(args);
+    }
+    return applyArray(function, argc, argv);
+}
+
 // evaluate if function
 Value *evalIf(Value *args, Frame *frame) {
     // check # of args
@@ -619,25 +701,35 @@ Value *evalIf(Value *args, Frame *frame) {
     }
 
     Value *evalValue = eval(car(args), frame); // first argument
-    if (!strcmp(evalValue->s, "#t")) {
+    if (evalValue->type != BOOL_TYPE || !strcmp(evalValue->s, "#t")) { // all but #f are true
         return eval(car(cdr(args)), frame); // second argument
     }
     return eval(car(cdr(cdr(args))), frame); // third argument
 }
 
-// find Value of the symol in all the frames, return most recent match
-Value *lookUpSymbol(Value *tree, Frame *frame) {
+// find Value bound to name in all the frames, return most recent match or
+// NULL if it is unbound
+Value *lookUpName(char *name, Frame *frame) {
     Frame *currFrame = frame;
     while(currFrame != NULL) { // check all layers of frame
         Value *currBindings = currFrame->bindings;
         while(!isNull(currBindings)) { /// check all bindings in a given frame
-            if(!strcmp(car(car(currBindings))->s, tree->s)){
+            if(!strcmp(car(car(currBindings))->s, name)){
                 return cdr(car(currBindings));
             }
             currBindings = cdr(currBindings);
         }
         currFrame = currFrame->parent;
     }
+    return NULL;
+}
+
+// find Value of the symol in all the frames, return most recent match
+Value *lookUpSymbol(Value *tree, Frame *frame) {
+    Value *value = lookUpName(tree->s, frame);
+    if (value != NULL) {
+        return value;
+    }
     printf("Evaluation error: symbol '%s' unbound.\n", tree->s);
     texit(1); 
     return NULL;
@@ -647,7 +739,7 @@ Value *lookUpSymbol(Value *tree, Frame *frame) {
 Value *evalLet(Value *args, Frame *frame){
     
     Frame *e = frame;
-    Frame *f = talloc(sizeof(Frame));
+    Frame *f = tallocKind(sizeof(Frame), FRAME_MEMORY);
     f->parent = e;
     f->bindings = makeNull();
     Value *pairs = car(args);
@@ -689,6 +781,7 @@ Value *evalLet(Value *args, Frame *frame){
         }
 
         // make binding
+        noteBinding(symbol->s);
         Value *binding = cons(symbol, eval(expression, e));
 
         // insert binding
@@ -744,11 +837,12 @@ Value *evalLetstar(Value *args, Frame *frame) {
             texit(1);
         }
 
-        Frame *current = talloc(sizeof(Frame));
+        Frame *current = tallocKind(sizeof(Frame), FRAME_MEMORY);
         current->parent = parent;
         current->bindings = makeNull();
 
         // make binding
+        noteBinding(symbol->s);
         Value *binding = cons(symbol, eval(expression, parent));
 
         // insert binding
@@ -775,7 +869,7 @@ Value *evalLetstar(Value *args, Frame *frame) {
 // eval letrec
 Value *evalLetrec(Value *args, Frame *frame) {
     // Create a new frame env’ with parent env.
-    Frame *env = talloc(sizeof(Frame));
+    Frame *env = tallocKind(sizeof(Frame), FRAME_MEMORY);
     env->parent = frame;
     env->bindings = makeNull();
     
@@ -818,6 +912,7 @@ Value *evalLetrec(Value *args, Frame *frame) {
         }
 
         // make binding
+        noteBinding(symbol->s);
         Value* unevaled = talloc(sizeof(Value));
         unevaled->type = UNSPECIFIED_TYPE;
         unevaled->p = expression;
@@ -874,7 +969,18 @@ Value *setBang(Value *args, Frame *f){
         while(!isNull(currBindings)) { /// check all bindings in a given frame
             if(!strcmp(car(car(currBindings))->s, car(args)->s)){
                 Value* binding = car(currBindings);
-                binding->c.cdr = eval(car(cdr(args)), f);
+                if (setRegion != NULL && !inRegion(binding, setRegion) && !inForm(binding)) {
+                    printf("Evaluation error: set! of a binding outside this program.\n");
+                    texit(1);
+                }
+                noteBinding(car(args)->s);
+                Value *value = eval(car(cdr(args)), f);
+                if (binding->c.cdr->type == CLOSURE_TYPE ||
+                    binding->c.cdr->type == PRIMITIVE_TYPE) {
+                    noteRebinding();
+                }
+                binding->c.cdr = value;
+                rememberValue(binding);
                 //printValue(binding);
 
                 Value* result = talloc(sizeof(Value));
@@ -971,136 +1077,1273 @@ Value *evalCond(Value *args, Frame *f) {
     return result;
 }
 
-// print error massage and exit program nicely
-void evaluationError() {
-    printf("Evaluation error: Unspecified. \n");
-    texit(1);
-    return;
+// PROMISES AND STREAMS
+
+// make an unforced promise to evaluate code in frame
+Value *makePromise(Value *code, Frame *frame) {
+    Value *promise = talloc(sizeof(Value));
+    promise->type = PROMISE_TYPE;
+    promise->pr.value = NULL;
+    promise->pr.code = code;
+    promise->pr.frame = frame;
+    return promise;
 }
 
+// make a promise to call function on args when forced
+Value *deferCall(Value *function, Value *args) {
+    return makePromise(cons(function, args), NULL);
+}
 
-// It is a thin wrapper that calls eval for each top-level S-expression in the program.
-// It prints out any necessary results before moving on to the next S-expression.
-void interpret(Value *tree) {
+// the value of a promise, computed the first time it is asked for; anything
+// other than a promise is its own value
+Value *force(Value *value) {
+    if (value->type != PROMISE_TYPE) {
+        return value;
+    }
+    if (value->pr.code != NULL) {
+        Value *code = value->pr.code;
+        Value *result;
+        if (value->pr.frame == NULL) {
+            result = apply(car(code), cdr(code));
+        } else {
+            result = eval(code, value->pr.frame);
+        }
+        // forcing the promise again from inside itself may have set it already
+        if (value->pr.code != NULL) {
+            value->pr.value = result;
+            value->pr.code = NULL;
+            value->pr.frame = NULL;
+            rememberValue(value);
+        }
+    }
+    return value->pr.value;
+}
 
-    // initialize frame
-    Frame *f = talloc(sizeof(Frame));
-    f->parent = NULL;
-    f->bindings = makeNull();
+// everything but #f counts as true
+int isTrue(Value *value) {
+    return value->type != BOOL_TYPE || strcmp(value->s, "#f");
+}
 
-    bind("+", primitiveAdd, f);
-    bind("cons", primitiveCons, f);
-    bind("car", primitiveCar, f);
-    bind("cdr", primitiveCdr, f);
-    bind("null?", primitiveNull, f);
-    bind("-", primitiveMinus, f);
-    bind("<", primitiveSmaller, f);
-    bind(">", primitiveLarger, f);
-    bind("=", primitiveEqual, f);
-    bind("modulo", primitiveModulo, f);
-    bind("/", primitiveDivide, f);
-    bind("*", primitiveMultiply, f);
+// eval delay
+Value *evalDelay(Value *args, Frame *frame) {
+    return makePromise(car(args), frame);
+}
 
+// eval cons-stream: the head now, the tail delayed
+Value *evalConsStream(Value *args, Frame *frame) {
+    return cons(eval(car(args), frame), makePromise(car(cdr(args)), frame));
+}
 
-    while(!isNull(tree)){
+// primitive function for force
+Value *primitiveForce(int argc, Value **argv) {
+    return force(argv[0]);
+}
 
-        Value *evaluated = eval(car(tree), f);
+// primitive function for make-promise: a promise already forced to the
+// argument, or the argument itself if it is a promise
+Value *primitiveMakePromise(int argc, Value **argv) {
+    if (argv[0]->type == PROMISE_TYPE) {
+        return argv[0];
+    }
+    Value *promise = makePromise(NULL, NULL);
+    promise->pr.value = argv[0];
+    return promise;
+}
 
-        printValue(evaluated);
+// The stream primitives take a stream, or a promise of one, and force it. A
+// non-empty stream must be a pair whose cdr is a promise (or a stream).
+Value *forceStream(Value *stream, char *name) {
+    stream = force(stream);
+    if (stream->type != CONS_TYPE && stream->type != NULL_TYPE) {
+        printf("Evaluation error: '%s' expects a stream.\n", name);
+        texit(1);
+    }
+    return stream;
+}
 
-        tree = cdr(tree);
+// primitive function for stream-car
+Value *primitiveStreamCar(int argc, Value **argv) {
+    Value *stream = forceStream(argv[0], "stream-car");
+    if (isNull(stream)) {
+        printf("Evaluation error: 'stream-car' of an empty stream.\n");
+        texit(1);
     }
+    return car(stream);
 }
 
+// primitive function for stream-cdr
+Value *primitiveStreamCdr(int argc, Value **argv) {
+    Value *stream = forceStream(argv[0], "stream-cdr");
+    if (isNull(stream)) {
+        printf("Evaluation error: 'stream-cdr' of an empty stream.\n");
+        texit(1);
+    }
+    return forceStream(cdr(stream), "stream-cdr");
+}
 
-// Given one expression tree and a frame in which to evaluate that expression, 
-// eval returns the Value of the expression.
-Value *eval(Value *tree, Frame *frame) {
-    Value *result;
+// primitive function for stream-map: applies the function to the heads of
+// the streams now, and defers mapping over their tails until they are needed
+Value *primitiveStreamMap(int argc, Value **argv) {
+    if (argc < 2) {
+        printf("Evaluation error: insufficient amount of arguments supplied to 'stream-map'\n");
+        texit(1);
+    }
+    Value *function = argv[0];
+    Value *heads[argc];
+    Value *tails = makeList(argc - 1);
+    Value *tail = tails;
+    for (int i = 1; i < argc; i++) {
+        Value *stream = forceStream(argv[i], "stream-map");
+        if (isNull(stream)) {
+            return stream;
+        }
+        heads[i - 1] = car(stream);
+        tail->c.car = cdr(stream);
+        tail = cdr(tail);
+    }
 
-    switch (tree->type) {
-        case INT_TYPE:
-            result = tree;
-            break;
+    Value *self = talloc(sizeof(Value));
+    self->type = PRIMITIVE_TYPE;
+    self->primitive = findPrimitive("stream-map");
+    Value *rest = deferCall(self, cons(function, tails));
+    return cons(applyArray(function, argc - 1, heads), rest);
+}
 
-        case DOUBLE_TYPE:
-            result = tree;
-            break;
+// primitive function for stream-filter: skips ahead to the first element
+// that satisfies the predicate, and defers filtering the rest
+Value *primitiveStreamFilter(int argc, Value **argv) {
+    Value *predicate = argv[0];
+    Value *stream = forceStream(argv[1], "stream-filter");
+    while (!isNull(stream) && !isTrue(applyArray(predicate, 1, &stream->c.car))) {
+        stream = forceStream(cdr(stream), "stream-filter");
+    }
+    if (isNull(stream)) {
+        return stream;
+    }
 
-        case BOOL_TYPE:
-            result = tree;
-            break;
+    Value *self = talloc(sizeof(Value));
+    self->type = PRIMITIVE_TYPE;
+    self->primitive = findPrimitive("stream-filter");
+    Value *rest = deferCall(self, cons(predicate, cons(cdr(stream), makeNull())));
+    return cons(car(stream), rest);
+}
 
-        case STR_TYPE:
-            result = tree;
+// primitive function for stream-take: a list of the first n elements of the
+// stream (fewer if it ends sooner)
+Value *primitiveStreamTake(int argc, Value **argv) {
+    Value *count = argv[1];
+    if (count->type != INT_TYPE || count->i < 0) {
+        printf("Evaluation error: 'stream-take' expects a count.\n");
+        texit(1);
+    }
+    Value *taken = makeNull();
+    Value *stream = argv[0];
+    for (int i = 0; i < count->i; i++) {
+        stream = forceStream(stream, "stream-take");
+        if (isNull(stream)) {
             break;
+        }
+        taken = cons(car(stream), taken);
+        stream = cdr(stream);
+    }
+    return reverse(taken);
+}
 
-        case SYMBOL_TYPE:
-            result = lookUpSymbol(tree, frame);
-            break;
-        
-        case CLOSURE_TYPE:
-            result = tree;
-        
-        case UNSPECIFIED_TYPE:
-            printf("Evaluation error: 'letrec' unspecified symbol.\n");
-            texit(1);
+// LIST LIBRARY
 
+// make a boolean value
+Value *makeBool(int truth) {
+    Value *result = talloc(sizeof(Value));
+    result->type = BOOL_TYPE;
+    result->s = truth ? "#t" : "#f";
+    return result;
+}
 
-        case CONS_TYPE: {
-            Value *first = car(tree);
-            Value *args = cdr(tree);
+// exit with an error unless list is a proper list, which linkedlist.c's
+// length and reverse rely on
+void checkList(Value *list, char *name) {
+    while (list->type == CONS_TYPE) {
+        list = list->c.cdr;
+    }
+    if (list->type != NULL_TYPE) {
+        printf("Evaluation error: '%s' expects a list.\n", name);
+        texit(1);
+    }
+}
 
-            // first symbol can't be null
-            if (isNull(first)) {
-                printf("Evaluation error: first expression can't be null.\n");
-                texit(1);
-            }
+// whether two values are equal? in the Scheme sense: same type and contents,
+// with lists compared element by element
+int isEqual(Value *a, Value *b) {
+    while (a != b) {
+        if (a->type != b->type) {
+            return 0;
+        }
+        switch (a->type) {
+            case INT_TYPE:
+                return a->i == b->i;
+            case DOUBLE_TYPE:
+                return a->d == b->d;
+            case STR_TYPE:
+            case SYMBOL_TYPE:
+            case BOOL_TYPE:
+                return !strcmp(a->s, b->s);
+            case NULL_TYPE:
+            case VOID_TYPE:
+                return 1;
+            case PRIMITIVE_TYPE:
+                return a->primitive == b->primitive;
+            case CONS_TYPE:
+                if (!isEqual(a->c.car, b->c.car)) {
+                    return 0;
+                }
+                a = a->c.cdr;
+                b = b->c.cdr;
+                break;
+            default:
+                return 0;
+        }
+    }
+    return 1;
+}
 
-            if (!strcmp(first->s,"if")) { // if
-                result = evalIf(args, frame); 
-            }
-            else if (!strcmp(first->s,"let")) { // let
-                result = evalLet(args, frame);
-            }
-            else if (!strcmp(first->s,"quote")) { //quote
-                result = evalQuote(args, frame);
-            }
-            else if (!strcmp(first->s, "define")) { //define
-                result = evalDefine(args, frame);
-            } 
-            else if (!strcmp(first->s, "lambda")) { //lambda
-                result = evalLambda(args, frame);
-            } 
-            else if (!strcmp(first->s, "let*")) {
-                result = evalLetstar(args, frame);
-            }
-            else if (!strcmp(first->s, "letrec")) {
-                result = evalLetrec(args, frame);
-            }
-            else if (!strcmp(first->s, "set!")) {
-                result = setBang(args, frame);
-            }
-            else if (!strcmp(first->s, "begin")) {
-                result = evalBegin(args, frame);
-            }
-            else if (!strcmp(first->s, "and")) {
-                result = evalAnd(args, frame);
-            }
-            else if (!strcmp(first->s, "or")) {
-                result = evalOr(args, frame);
-            }
-            else if (!strcmp(first->s, "cond")) {
-                result = evalCond(args, frame);
+// primitive function for length
+Value *primitiveLength(int argc, Value **argv) {
+    checkList(argv[0], "length");
+    Value *result = tallocKind(sizeof(Value), NUMBER_MEMORY);
+    result->type = INT_TYPE;
+    result->i = length(argv[0]);
+    return result;
+}
+
+// primitive function for reverse
+Value *primitiveReverse(int argc, Value **argv) {
+    checkList(argv[0], "reverse");
+    return reverse(argv[0]);
+}
+
+// primitive function for append: copies every list but the last, which the
+// result shares
+Value *primitiveAppend(int argc, Value **argv) {
+    if (argc == 0) {
+        return makeNull();
+    }
+    Value *result = argv[argc - 1];
+    for (int i = argc - 2; i >= 0; i--) {
+        checkList(argv[i], "append");
+        for (Value *item = reverse(argv[i]); !isNull(item); item = cdr(item)) {
+            result = cons(car(item), result);
+        }
+    }
+    return result;
+}
+
+// primitive function for sort: a sorted copy of the list
+Value *primitiveSort(int argc, Value **argv) {
+    checkList(argv[0], "sort");
+    if (argv[1]->type != CLOSURE_TYPE && argv[1]->type != PRIMITIVE_TYPE) {
+        printf("Evaluation error: 'sort' expects a procedure.\n");
+        texit(1);
+    }
+    return sortList(argv[0], argv[1]);
+}
+
+// primitive function for list-ref
+Value *primitiveListRef(int argc, Value **argv) {
+    Value *list = argv[0];
+    Value *index = argv[1];
+    if (index->type != INT_TYPE || index->i < 0) {
+        printf("Evaluation error: 'list-ref' expects an index.\n");
+        texit(1);
+    }
+    for (int i = 0; i < index->i && list->type == CONS_TYPE; i++) {
+        list = cdr(list);
+    }
+    if (list->type != CONS_TYPE) {
+        printf("Evaluation error: 'list-ref' index out of range.\n");
+        texit(1);
+    }
+    return car(list);
+}
+
+// Put the head of each of the count lists into heads and move the list on to
+// its tail, returning 0 once any of them has run out.
+int splitLists(int count, Value **lists, Value **heads) {
+    for (int i = 0; i < count; i++) {
+        if (lists[i]->type != CONS_TYPE) {
+            return 0;
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        heads[i] = lists[i]->c.car;
+        lists[i] = lists[i]->c.cdr;
+    }
+    return 1;
+}
+
+// check the arguments of map, for-each and fold: a function, and then one or
+// more lists after the first skip arguments
+void checkListArgs(int argc, Value **argv, int skip, char *name) {
+    if (argc < skip + 2) {
+        printf("Evaluation error: insufficient amount of arguments supplied to '%s'\n", name);
+        texit(1);
+    }
+    for (int i = skip + 1; i < argc; i++) {
+        checkList(argv[i], name);
+    }
+}
+
+// primitive function for map, stopping at the end of the shortest list
+Value *primitiveMap(int argc, Value **argv) {
+    checkListArgs(argc, argv, 0, "map");
+    Value *function = argv[0];
+    int count = argc - 1;
+    Value *lists[count];
+    Value *heads[count];
+    memcpy(lists, argv + 1, count * sizeof(Value *));
+    Value *results = makeNull();
+    while (splitLists(count, lists, heads)) {
+        results = cons(applyArray(function, count, heads), results);
+    }
+    return reverse(results);
+}
+
+// primitive function for for-each
+Value *primitiveForEach(int argc, Value **argv) {
+    checkListArgs(argc, argv, 0, "for-each");
+    Value *function = argv[0];
+    int count = argc - 1;
+    Value *lists[count];
+    Value *heads[count];
+    memcpy(lists, argv + 1, count * sizeof(Value *));
+    while (splitLists(count, lists, heads)) {
+        applyArray(function, count, heads);
+    }
+    Value *result = talloc(sizeof(Value));
+    result->type = VOID_TYPE;
+    return result;
+}
+
+// primitive function for filter
+Value *primitiveFilter(int argc, Value **argv) {
+    checkList(argv[1], "filter");
+    Value *predicate = argv[0];
+    Value *kept = makeNull();
+    for (Value *list = argv[1]; !isNull(list); list = cdr(list)) {
+        if (isTrue(applyArray(predicate, 1, &list->c.car))) {
+            kept = cons(car(list), kept);
+        }
+    }
+    return reverse(kept);
+}
+
+// primitive function for fold: (fold kons knil list ...) calls kons on the
+// elements and the result so far, from the left
+Value *primitiveFold(int argc, Value **argv) {
+    checkListArgs(argc, argv, 1, "fold");
+    Value *function = argv[0];
+    int count = argc - 2;
+    Value *lists[count];
+    // the elements, followed by the result so far
+    Value *heads[count + 1];
+    memcpy(lists, argv + 2, count * sizeof(Value *));
+    heads[count] = argv[1];
+    while (splitLists(count, lists, heads)) {
+        heads[count] = applyArray(function, count + 1, heads);
+    }
+    return heads[count];
+}
+
+// primitive function for member: the first tail of the list whose car is
+// equal? to the item, or #f
+Value *primitiveMember(int argc, Value **argv) {
+    checkList(argv[1], "member");
+    for (Value *list = argv[1]; !isNull(list); list = cdr(list)) {
+        if (isEqual(argv[0], car(list))) {
+            return list;
+        }
+    }
+    return makeBool(0);
+}
+
+// primitive function for assoc: the first pair in the list whose car is
+// equal? to the key, or #f
+Value *primitiveAssoc(int argc, Value **argv) {
+    checkList(argv[1], "assoc");
+    for (Value *list = argv[1]; !isNull(list); list = cdr(list)) {
+        Value *pair = car(list);
+        if (pair->type != CONS_TYPE) {
+            printf("Evaluation error: 'assoc' expects a list of pairs.\n");
+            texit(1);
+        }
+        if (isEqual(argv[0], car(pair))) {
+            return pair;
+        }
+    }
+    return makeBool(0);
+}
+
+// F64VECTORS
+
+// make an f64vector of length elements, not yet filled in
+Value *makeF64Vector(int length) {
+    Value *vector = talloc(sizeof(Value));
+    vector->type = F64VECTOR_TYPE;
+    vector->fv.length = length;
+    vector->fv.elements = talloc(length * sizeof(double));
+    return vector;
+}
+
+// make a double value
+Value *makeDouble(double d) {
+    Value *result = tallocKind(sizeof(Value), NUMBER_MEMORY);
+    result->type = DOUBLE_TYPE;
+    result->d = d;
+    return result;
+}
+
+// exit with an error unless value is an f64vector
+Value *checkVector(Value *value, char *name) {
+    if (value->type != F64VECTOR_TYPE) {
+        printf("Evaluation error: '%s' expects an f64vector.\n", name);
+        texit(1);
+    }
+    return value;
+}
+
+// the number value holds as a double, exiting with an error if it isn't one
+double checkNumber(Value *value, char *name) {
+    if (value->type == INT_TYPE) {
+        return value->i;
+    }
+    if (value->type != DOUBLE_TYPE) {
+        printf("Evaluation error: '%s' expects a number.\n", name);
+        texit(1);
+    }
+    return value->d;
+}
+
+// the element index that value refers to in vector, exiting with an error if
+// it is out of range
+int checkIndex(Value *vector, Value *value, char *name) {
+    if (value->type != INT_TYPE || value->i < 0 || value->i >= vector->fv.length) {
+        printf("Evaluation error: '%s' index out of range.\n", name);
+        texit(1);
+    }
+    return value->i;
+}
+
+// the two vectors of an element-wise operation, which must be the same length
+void checkPair(Value **argv, char *name, Value **a, Value **b) {
+    *a = checkVector(argv[0], name);
+    *b = checkVector(argv[1], name);
+    if ((*a)->fv.length != (*b)->fv.length) {
+        printf("Evaluation error: '%s' expects f64vectors of the same length.\n", name);
+        texit(1);
+    }
+}
+
+// primitive function for make-f64vector, filled with 0.0 unless a fill value
+// is given
+Value *primitiveMakeF64Vector(int argc, Value **argv) {
+    if (argc < 1 || argc > 2) {
+        printf("Evaluation error: 'make-f64vector' takes 1 or 2 arguments.\n");
+        texit(1);
+    }
+    if (argv[0]->type != INT_TYPE || argv[0]->i < 0) {
+        printf("Evaluation error: 'make-f64vector' expects a length.\n");
+        texit(1);
+    }
+    double fill = argc == 2 ? checkNumber(argv[1], "make-f64vector") : 0;
+    Value *vector = makeF64Vector(argv[0]->i);
+    for (int i = 0; i < vector->fv.length; i++) {
+        vector->fv.elements[i] = fill;
+    }
+    return vector;
+}
+
+// primitive function for list->f64vector
+Value *primitiveListToF64Vector(int argc, Value **argv) {
+    checkList(argv[0], "list->f64vector");
+    Value *vector = makeF64Vector(length(argv[0]));
+    int i = 0;
+    for (Value *list = argv[0]; !isNull(list); list = cdr(list)) {
+        vector->fv.elements[i++] = checkNumber(car(list), "list->f64vector");
+    }
+    return vector;
+}
+
+// primitive function for f64vector, which makes one of its arguments
+Value *primitiveF64Vector(int argc, Value **argv) {
+    Value *vector = makeF64Vector(argc);
+    for (int i = 0; i < argc; i++) {
+        vector->fv.elements[i] = checkNumber(argv[i], "f64vector");
+    }
+    return vector;
+}
+
+// primitive function for f64vector->list
+Value *primitiveF64VectorToList(int argc, Value **argv) {
+    Value *vector = checkVector(argv[0], "f64vector->list");
+    Value *list = makeNull();
+    for (int i = vector->fv.length - 1; i >= 0; i--) {
+        list = cons(makeDouble(vector->fv.elements[i]), list);
+    }
+    return list;
+}
+
+// primitive function for f64vector?
+Value *primitiveIsF64Vector(int argc, Value **argv) {
+    return makeBool(argv[0]->type == F64VECTOR_TYPE);
+}
+
+// primitive function for f64vector-length
+Value *primitiveF64VectorLength(int argc, Value **argv) {
+    Value *result = tallocKind(sizeof(Value), NUMBER_MEMORY);
+    result->type = INT_TYPE;
+    result->i = checkVector(argv[0], "f64vector-length")->fv.length;
+    return result;
+}
+
+// primitive function for f64vector-ref
+Value *primitiveF64VectorRef(int argc, Value **argv) {
+    Value *vector = checkVector(argv[0], "f64vector-ref");
+    int index = checkIndex(vector, argv[1], "f64vector-ref");
+    return makeDouble(vector->fv.elements[index]);
+}
+
+// primitive function for f64vector-set!
+Value *primitiveF64VectorSet(int argc, Value **argv) {
+    Value *vector = checkVector(argv[0], "f64vector-set!");
+    int index = checkIndex(vector, argv[1], "f64vector-set!");
+    vector->fv.elements[index] = checkNumber(argv[2], "f64vector-set!");
+    Value *result = talloc(sizeof(Value));
+    result->type = VOID_TYPE;
+    return result;
+}
+
+// primitive function for f64vector-add, the element-wise sum
+Value *primitiveF64VectorAdd(int argc, Value **argv) {
+    Value *a, *b;
+    checkPair(argv, "f64vector-add", &a, &b);
+    Value *result = makeF64Vector(a->fv.length);
+    f64Add(result->fv.elements, a->fv.elements, b->fv.elements, a->fv.length);
+    return result;
+}
+
+// primitive function for f64vector-mul, the element-wise product
+Value *primitiveF64VectorMul(int argc, Value **argv) {
+    Value *a, *b;
+    checkPair(argv, "f64vector-mul", &a, &b);
+    Value *result = makeF64Vector(a->fv.length);
+    f64Mul(result->fv.elements, a->fv.elements, b->fv.elements, a->fv.length);
+    return result;
+}
+
+// primitive function for f64vector-scale, which multiplies every element by
+// a number
+Value *primitiveF64VectorScale(int argc, Value **argv) {
+    Value *vector = checkVector(argv[0], "f64vector-scale");
+    double factor = checkNumber(argv[1], "f64vector-scale");
+    Value *result = makeF64Vector(vector->fv.length);
+    f64Scale(result->fv.elements, vector->fv.elements, factor, vector->fv.length);
+    return result;
+}
+
+// primitive function for f64vector-dot
+Value *primitiveF64VectorDot(int argc, Value **argv) {
+    Value *a, *b;
+    checkPair(argv, "f64vector-dot", &a, &b);
+    return makeDouble(f64Dot(a->fv.elements, b->fv.elements, a->fv.length));
+}
+
+// primitive function for f64vector-sum
+Value *primitiveF64VectorSum(int argc, Value **argv) {
+    Value *vector = checkVector(argv[0], "f64vector-sum");
+    return makeDouble(f64Sum(vector->fv.elements, vector->fv.length));
+}
+
+// the vector argument of f64vector-min or f64vector-max, which can't be empty
+Value *checkNonEmpty(Value *value, char *name) {
+    Value *vector = checkVector(value, name);
+    if (vector->fv.length == 0) {
+        printf("Evaluation error: '%s' of an empty f64vector.\n", name);
+        texit(1);
+    }
+    return vector;
+}
+
+// primitive function for f64vector-min
+Value *primitiveF64VectorMin(int argc, Value **argv) {
+    Value *vector = checkNonEmpty(argv[0], "f64vector-min");
+    return makeDouble(f64Min(vector->fv.elements, vector->fv.length));
+}
+
+// primitive function for f64vector-max
+Value *primitiveF64VectorMax(int argc, Value **argv) {
+    Value *vector = checkNonEmpty(argv[0], "f64vector-max");
+    return makeDouble(f64Max(vector->fv.elements, vector->fv.length));
+}
+
+// PORTS
+
+// make the value read functions return at the end of a file
+Value *makeEof() {
+    Value *result = talloc(sizeof(Value));
+    result->type = EOF_TYPE;
+    return result;
+}
+
+// make a string value holding length bytes of text
+Value *makeString(char *text, size_t length) {
+    Value *result = talloc(sizeof(Value));
+    result->type = STR_TYPE;
+    result->s = talloc(length + 3);
+    result->s[0] = '"';
+    memcpy(result->s + 1, text, length);
+    result->s[length + 1] = '"';
+    result->s[length + 2] = '\0';
+    return result;
+}
+
+// the text of a string value, without its quotes
+char *stringContents(Value *string, char *name) {
+    if (string->type != STR_TYPE) {
+        printf("Evaluation error: '%s' expects a string.\n", name);
+        texit(1);
+    }
+    size_t length = strlen(string->s) - 2;
+    char *text = talloc(length + 1);
+    memcpy(text, string->s + 1, length);
+    text[length] = '\0';
+    return text;
+}
+
+// The port given as the optional last argument of a read or write primitive,
+// the count arguments in argv being what is left after the others. Without
+// one, reads come from standard input and writes go to the program's output,
+// for which NULL is returned.
+Port *portArgument(int count, Value **argv, int input, char *name) {
+    if (count == 0) {
+        return input ? standardInputPort() : NULL;
+    }
+    if (count > 1) {
+        printf("Evaluation error: too many arguments supplied to '%s'\n", name);
+        texit(1);
+    }
+    Value *port = argv[0];
+    if (port->type != PORT_TYPE || isInputPort(port->port) != input) {
+        printf("Evaluation error: '%s' expects an %s port.\n", name, input ? "input" : "output");
+        texit(1);
+    }
+    if (isPortClosed(port->port)) {
+        printf("Evaluation error: '%s' on a closed port.\n", name);
+        texit(1);
+    }
+    return port->port;
+}
+
+// open-input-file and open-output-file
+Value *openFile(Value *pathArgument, int input, char *name) {
+    char *path = stringContents(pathArgument, name);
+    Port *port = input ? openInputPort(path) : openOutputPort(path);
+    if (port == NULL) {
+        printf("Evaluation error: '%s' cannot open %s.\n", name, path);
+        texit(1);
+    }
+    Value *result = talloc(sizeof(Value));
+    result->type = PORT_TYPE;
+    result->port = port;
+    return result;
+}
+
+// primitive function for open-input-file
+Value *primitiveOpenInputFile(int argc, Value **argv) {
+    return openFile(argv[0], 1, "open-input-file");
+}
+
+// primitive function for open-output-file
+Value *primitiveOpenOutputFile(int argc, Value **argv) {
+    return openFile(argv[0], 0, "open-output-file");
+}
+
+// primitive function for read-line: the next line without its newline, or
+// the end-of-file object
+Value *primitiveReadLine(int argc, Value **argv) {
+    Port *port = portArgument(argc, argv, 1, "read-line");
+    size_t length;
+    char *line = portReadLine(port, &length);
+    if (line == NULL) {
+        return makeEof();
+    }
+    return makeString(line, length);
+}
+
+// There is no character type, so read-char and peek-char return characters
+// as strings of length one.
+Value *readCharacter(int argc, Value **argv, int peek, char *name) {
+    Port *port = portArgument(argc, argv, 1, name);
+    int c = peek ? portPeek(port) : portRead(port);
+    if (c == EOF) {
+        return makeEof();
+    }
+    char character = c;
+    return makeString(&character, 1);
+}
+
+// primitive function for read-char
+Value *primitiveReadChar(int argc, Value **argv) {
+    return readCharacter(argc, argv, 0, "read-char");
+}
+
+// primitive function for peek-char
+Value *primitivePeekChar(int argc, Value **argv) {
+    return readCharacter(argc, argv, 1, "peek-char");
+}
+
+// primitive function for read: the next datum, parsed as program text is
+Value *primitiveRead(int argc, Value **argv) {
+    Port *port = portArgument(argc, argv, 1, "read");
+    Value *tokens = tokenizeDatum(port);
+    if (tokens == NULL) {
+        return makeEof();
+    }
+    return car(parse(tokens));
+}
+
+// write text to port, or to the program's output if port is NULL
+void writeText(Port *port, char *text, size_t length) {
+    if (port == NULL) {
+        for (size_t i = 0; i < length; i++) {
+            outputChar(text[i]);
+        }
+    } else {
+        portWrite(port, text, length);
+    }
+}
+
+// primitive function for write-string
+Value *primitiveWriteString(int argc, Value **argv) {
+    if (argc == 0) {
+        printf("Evaluation error: no argument supplied to 'write-string'\n");
+        texit(1);
+    }
+    Port *port = portArgument(argc - 1, argv + 1, 0, "write-string");
+    char *text = stringContents(argv[0], "write-string");
+    writeText(port, text, strlen(text));
+    Value *result = talloc(sizeof(Value));
+    result->type = VOID_TYPE;
+    return result;
+}
+
+// primitive function for newline
+Value *primitiveNewline(int argc, Value **argv) {
+    writeText(portArgument(argc, argv, 0, "newline"), "\n", 1);
+    Value *result = talloc(sizeof(Value));
+    result->type = VOID_TYPE;
+    return result;
+}
+
+// primitive function for close-port
+Value *primitiveClosePort(int argc, Value **argv) {
+    if (argv[0]->type != PORT_TYPE) {
+        printf("Evaluation error: 'close-port' expects a port.\n");
+        texit(1);
+    }
+    closePort(argv[0]->port);
+    Value *result = talloc(sizeof(Value));
+    result->type = VOID_TYPE;
+    return result;
+}
+
+// primitive function for eof-object?
+Value *primitiveIsEof(int argc, Value **argv) {
+    return makeBool(argv[0]->type == EOF_TYPE);
+}
+
+// LIMITS
+
+// eval with-limits: (with-limits ((steps n) (seconds s) (depth d) (bytes b))
+// body ...) evaluates the body under those limits as well as the ones
+// already in force; any of the four can be left out
+Value *evalWithLimits(Value *args, Frame *frame) {
+    if (isNull(args)) {
+        printf("Evaluation error: 'with-limits' has no limits.\n");
+        texit(1);
+    }
+    Limits limits = {0};
+    for (Value *specs = car(args); !isNull(specs); specs = cdr(specs)) {
+        if (specs->type != CONS_TYPE || car(specs)->type != CONS_TYPE ||
+            length(car(specs)) != 2 || car(car(specs))->type != SYMBOL_TYPE) {
+            printf("Evaluation error: bad limit in 'with-limits'.\n");
+            texit(1);
+        }
+        char *name = car(car(specs))->s;
+        double amount = checkNumber(eval(car(cdr(car(specs))), frame), "with-limits");
+        if (amount <= 0) {
+            printf("Evaluation error: 'with-limits' expects positive limits.\n");
+            texit(1);
+        }
+        if (!strcmp(name, "steps")) {
+            limits.steps = amount;
+        } else if (!strcmp(name, "seconds")) {
+            limits.seconds = amount;
+        } else if (!strcmp(name, "depth")) {
+            limits.depth = amount;
+        } else if (!strcmp(name, "bytes")) {
+            limits.bytes = amount;
+        } else {
+            printf("Evaluation error: unknown limit '%s' in 'with-limits'.\n", name);
+            texit(1);
+        }
+    }
+    pushLimits(&limits);
+    Value *result = evalBegin(cdr(args), frame);
+    popLimits();
+    return result;
+}
+
+// LOAD
+
+// primitive function for load: evaluates the forms of a file at the top
+// level of the program, without printing their values
+Value *primitiveLoad(int argc, Value **argv) {
+    char *path = stringContents(argv[0], "load");
+    Value *tree = loadTree(path);
+    if (tree == NULL) {
+        printf("Evaluation error: 'load' cannot open %s.\n", path);
+        texit(1);
+    }
+    for (; !isNull(tree); tree = cdr(tree)) {
+        eval(expand(car(tree), topFrame), topFrame);
+    }
+    Value *result = talloc(sizeof(Value));
+    result->type = VOID_TYPE;
+    return result;
+}
+
+// BINARY DATA
+
+// primitive function for write-binary: saves a datum of numbers, strings,
+// symbols, booleans and lists to a file that load-binary maps back in
+Value *primitiveWriteBinary(int argc, Value **argv) {
+    char *path = stringContents(argv[1], "write-binary");
+    int status = writeDatum(path, argv[0]);
+    if (status == 2) {
+        printf("Evaluation error: 'write-binary' can only write numbers, strings, "
+               "symbols, booleans and lists.\n");
+        texit(1);
+    } else if (status != 0) {
+        printf("Evaluation error: 'write-binary' cannot write %s.\n", path);
+        texit(1);
+    }
+    Value *result = talloc(sizeof(Value));
+    result->type = VOID_TYPE;
+    return result;
+}
+
+// primitive function for load-binary: the datum in a file saved by
+// write-binary, used in place from a read-only mapping of the file
+Value *primitiveLoadBinary(int argc, Value **argv) {
+    char *path = stringContents(argv[0], "load-binary");
+    Value *datum = readDatum(path);
+    if (datum == NULL) {
+        printf("Evaluation error: 'load-binary' cannot load %s.\n", path);
+        texit(1);
+    }
+    return datum;
+}
+
+// ACTORS
+
+// primitive function for spawn-actor: starts an actor calling a procedure of
+// no arguments on a thread of its own
+Value *primitiveSpawnActor(int argc, Value **argv) {
+    if (argv[0]->type != CLOSURE_TYPE || !isNull(argv[0]->cl.paramNames)) {
+        printf("Evaluation error: 'spawn-actor' expects a procedure of no arguments.\n");
+        texit(1);
+    }
+    // the heap profiler and the position table are not made for threads
+    if (isTrackingPositions()) {
+        printf("Evaluation error: 'spawn-actor' is not available while profiling the heap.\n");
+        texit(1);
+    }
+    Actor *actor = spawnActor(argv[0]);
+    if (actor == NULL) {
+        printf("Evaluation error: 'spawn-actor' cannot start a thread.\n");
+        texit(1);
+    }
+    Value *result = talloc(sizeof(Value));
+    result->type = ACTOR_TYPE;
+    result->actor = actor;
+    return result;
+}
+
+// primitive function for send: sends a copy of a message to an actor
+Value *primitiveSend(int argc, Value **argv) {
+    if (argv[0]->type != ACTOR_TYPE) {
+        printf("Evaluation error: 'send' expects an actor.\n");
+        texit(1);
+    }
+    if (sendMessage(argv[0]->actor, argv[1]) != 0) {
+        printf("Evaluation error: 'send' can only send numbers, strings, symbols, "
+               "booleans, lists, f64vectors and actors.\n");
+        texit(1);
+    }
+    Value *result = talloc(sizeof(Value));
+    result->type = VOID_TYPE;
+    return result;
+}
+
+// primitive function for receive: the next message sent to the actor calling
+// it, waiting for one if need be
+Value *primitiveReceive(int argc, Value **argv) {
+    return receiveMessage();
+}
+
+// primitive function for self: the actor calling it
+Value *primitiveSelf(int argc, Value **argv) {
+    Value *result = talloc(sizeof(Value));
+    result->type = ACTOR_TYPE;
+    result->actor = currentActor();
+    return result;
+}
+
+// primitive function for actor?
+Value *primitiveIsActor(int argc, Value **argv) {
+    return makeBool(argv[0]->type == ACTOR_TYPE);
+}
+
+// TASKS
+
+// primitive function for spawn: starts a task calling a procedure of no
+// arguments, which runs once the caller gives up its turn
+Value *primitiveSpawn(int argc, Value **argv) {
+    if (argv[0]->type != CLOSURE_TYPE || !isNull(argv[0]->cl.paramNames)) {
+        printf("Evaluation error: 'spawn' expects a procedure of no arguments.\n");
+        texit(1);
+    }
+    if (spawnTask(argv[0]) != 0) {
+        printf("Evaluation error: 'spawn' cannot make a stack for the task.\n");
+        texit(1);
+    }
+    Value *result = talloc(sizeof(Value));
+    result->type = VOID_TYPE;
+    return result;
+}
+
+// primitive function for yield
+Value *primitiveYield(int argc, Value **argv) {
+    yieldTask();
+    Value *result = talloc(sizeof(Value));
+    result->type = VOID_TYPE;
+    return result;
+}
+
+// primitive function for sleep: lets other tasks run for a number of seconds
+Value *primitiveSleep(int argc, Value **argv) {
+    double seconds;
+    if (argv[0]->type == INT_TYPE) {
+        seconds = argv[0]->i;
+    } else if (argv[0]->type == DOUBLE_TYPE) {
+        seconds = argv[0]->d;
+    } else {
+        printf("Evaluation error: 'sleep' expects a number of seconds.\n");
+        texit(1);
+    }
+    sleepTask(seconds);
+    Value *result = talloc(sizeof(Value));
+    result->type = VOID_TYPE;
+    return result;
+}
+
+// print error massage and exit program nicely
+void evaluationError() {
+    printf("Evaluation error: Unspecified. \n");
+    texit(1);
+    return;
+}
+
+
+// every primitive function, under the name it is bound to in the global frame,
+// with its arity
+static Primitive primitives[] = {
+    {"+", -1, primitiveAdd, primitiveAdd2},
+    {"cons", 2, primitiveCons},
+    {"car", 1, primitiveCar},
+    {"cdr", 1, primitiveCdr},
+    {"null?", 1, primitiveNull},
+    {"-", 2, primitiveMinus},
+    {"<", 2, primitiveSmaller},
+    {">", 2, primitiveLarger},
+    {"=", 2, primitiveEqual},
+    {"modulo", 2, primitiveModulo},
+    {"/", 2, primitiveDivide},
+    {"*", -1, primitiveMultiply, primitiveMultiply2},
+    {"force", 1, primitiveForce},
+    {"make-promise", 1, primitiveMakePromise},
+    {"stream-car", 1, primitiveStreamCar},
+    {"stream-cdr", 1, primitiveStreamCdr},
+    {"stream-map", -1, primitiveStreamMap},
+    {"stream-filter", 2, primitiveStreamFilter},
+    {"stream-take", 2, primitiveStreamTake},
+    {"length", 1, primitiveLength},
+    {"append", -1, primitiveAppend},
+    {"reverse", 1, primitiveReverse},
+    {"sort", 2, primitiveSort},
+    {"map", -1, primitiveMap},
+    {"for-each", -1, primitiveForEach},
+    {"filter", 2, primitiveFilter},
+    {"fold", -1, primitiveFold},
+    {"assoc", 2, primitiveAssoc},
+    {"member", 2, primitiveMember},
+    {"list-ref", 2, primitiveListRef},
+    {"make-f64vector", -1, primitiveMakeF64Vector},
+    {"f64vector", -1, primitiveF64Vector},
+    {"f64vector?", 1, primitiveIsF64Vector},
+    {"f64vector-length", 1, primitiveF64VectorLength},
+    {"f64vector-ref", 2, primitiveF64VectorRef},
+    {"f64vector-set!", 3, primitiveF64VectorSet},
+    {"list->f64vector", 1, primitiveListToF64Vector},
+    {"f64vector->list", 1, primitiveF64VectorToList},
+    {"f64vector-add", 2, primitiveF64VectorAdd},
+    {"f64vector-mul", 2, primitiveF64VectorMul},
+    {"f64vector-scale", 2, primitiveF64VectorScale},
+    {"f64vector-dot", 2, primitiveF64VectorDot},
+    {"f64vector-sum", 1, primitiveF64VectorSum},
+    {"f64vector-min", 1, primitiveF64VectorMin},
+    {"f64vector-max", 1, primitiveF64VectorMax},
+    {"open-input-file", 1, primitiveOpenInputFile},
+    {"open-output-file", 1, primitiveOpenOutputFile},
+    {"read-line", -1, primitiveReadLine},
+    {"read-char", -1, primitiveReadChar},
+    {"peek-char", -1, primitivePeekChar},
+    {"read", -1, primitiveRead},
+    {"write-string", -1, primitiveWriteString},
+    {"newline", -1, primitiveNewline},
+    {"close-port", 1, primitiveClosePort},
+    {"eof-object?", 1, primitiveIsEof},
+    {"load", 1, primitiveLoad},
+    {"write-binary", 2, primitiveWriteBinary},
+    {"load-binary", 1, primitiveLoadBinary},
+    {"spawn-actor", 1, primitiveSpawnActor},
+    {"send", 2, primitiveSend},
+    {"receive", 0, primitiveReceive},
+    {"self", 0, primitiveSelf},
+    {"actor?", 1, primitiveIsActor},
+    {"spawn", 1, primitiveSpawn},
+    {"yield", 0, primitiveYield},
+    {"sleep", 1, primitiveSleep},
+};
+
+#define PRIMITIVE_COUNT (sizeof(primitives) / sizeof(primitives[0]))
+
+// The primitive bound to name, or NULL if there is none.
+Primitive *findPrimitive(char *name) {
+    for (size_t i = 0; i < PRIMITIVE_COUNT; i++) {
+        if (!strcmp(primitives[i].name, name)) {
+            return &primitives[i];
+        }
+    }
+    return NULL;
+}
+
+// Create a top-level frame with all the primitive functions bound in it.
+Frame *makeGlobalFrame() {
+
+    // initialize frame
+    Frame *f = tallocKind(sizeof(Frame), FRAME_MEMORY);
+    f->parent = NULL;
+    f->bindings = makeNull();
+
+    for (size_t i = 0; i < PRIMITIVE_COUNT; i++) {
+        bindPrimitive(&primitives[i], f);
+    }
+
+    return f;
+}
+
+// Restrict set! to bindings that were allocated in region; NULL lifts the
+// restriction. Used when the frames around the program outlive its memory.
+void restrictSet(Region *region) {
+    setRegion = region;
+}
+
+// Make frame the one load evaluates files in, for threads that don't go
+// through interpretInFrame.
+void setTopFrame(Frame *frame) {
+    topFrame = frame;
+}
+
+// Evaluate each top-level S-expression of tree in frame, printing the results.
+void interpretInFrame(Value *tree, Frame *f) {
+    Frame *previousTop = topFrame;
+    topFrame = f;
+
+    while(!isNull(tree)){
+
+        // whatever the form allocates is freed after it, except what it
+        // stores into the frame
+        beginForm();
+        Value *evaluated = eval(expand(car(tree), f), f);
+
+        printValue(evaluated);
+        if (hasOtherTasks()) {
+            keepForm();
+        } else {
+            endForm();
+        }
+
+        tree = cdr(tree);
+    }
+
+    topFrame = previousTop;
+}
+
+// It is a thin wrapper that calls eval for each top-level S-expression in the program.
+// It prints out any necessary results before moving on to the next S-expression.
+void interpret(Value *tree) {
+    interpretInFrame(tree, makeGlobalFrame());
+}
+
+
+// Evaluate a call: evaluate the operator and the arguments, then apply the one
+// to the others. A call that hasn't been specialized yet is specialized to
+// the arguments it was just made on, if it can be.
+static Value *evalCall(Value *tree, Frame *frame) {
+    Value *operator = eval(car(tree), frame);
+    Value *args = cdr(tree);
+    Value *evaledArgs[length(args) + 1];
+    int count = 0;
+    for (; !isNull(args); args = cdr(args)) {
+        evaledArgs[count++] = eval(car(args), frame);
+    }
+    if (tree->quick == QUICK_CALL) {
+        tree->quick = specializeCall(car(tree), operator, count, evaledArgs);
+    }
+    return applyArray(operator, count, evaledArgs);
+}
+
+// Evaluate a specialized call. The operator isn't looked up (its step is
+// still counted); if the operands don't fit, the call is made the generic way
+// on them and stays generic from then on.
+static Value *evalSpecialized(Value *tree, Frame *frame) {
+    countStep();
+    Value *argv[2];
+    argv[0] = eval(car(cdr(tree)), frame);
+    argv[1] = eval(car(cdr(cdr(tree))), frame);
+    Value *result = runSpecialized(tree->quick, argv[0], argv[1]);
+    if (result != NULL) {
+        return result;
+    }
+    tree->quick = QUICK_GENERIC;
+    return applyArray(lookUpSymbol(car(tree), frame), 2, argv);
+}
+
+// Given one expression tree and a frame in which to evaluate that expression, 
+// eval returns the Value of the expression.
+Value *eval(Value *tree, Frame *frame) {
+    Value *result;
+    countStep();
+
+    switch (tree->type) {
+        case INT_TYPE:
+            result = tree;
+            break;
+
+        case DOUBLE_TYPE:
+            result = tree;
+            break;
+
+        case BOOL_TYPE:
+            result = tree;
+            break;
+
+        case STR_TYPE:
+            result = tree;
+            break;
+
+        case SYMBOL_TYPE:
+            result = lookUpSymbol(tree, frame);
+            break;
+        
+        case CLOSURE_TYPE:
+            result = tree;
+        
+        case UNSPECIFIED_TYPE:
+            printf("Evaluation error: 'letrec' unspecified symbol.\n");
+            texit(1);
+
+
+        case CONS_TYPE: {
+            Value *first = car(tree);
+            Value *args = cdr(tree);
+            Value *outerSite = enterSite(tree);
+
+            // the first evaluation finds out what kind of list this is
+            if (tree->quick == QUICK_UNSEEN) {
+                // first symbol can't be null
+                if (isNull(first)) {
+                    printf("Evaluation error: first expression can't be null.\n");
+                    texit(1);
+                }
+                tree->quick = classifyList(first);
             }
-            else {
-                // If not a special form, evaluate the first, evaluate the args, then
-                // apply the first to the args.
-                Value *evaledOperator = eval(first, frame);
-                Value *evaledArgs = evalEach(args, frame);
 
-                return apply(evaledOperator,evaledArgs);
+            switch (tree->quick) {
+                case QUICK_IF:
+                    result = evalIf(args, frame);
+                    break;
+                case QUICK_LET:
+                    result = evalLet(args, frame);
+                    break;
+                case QUICK_QUOTE:
+                    result = evalQuote(args, frame);
+                    break;
+                case QUICK_DEFINE:
+                    result = evalDefine(args, frame);
+                    break;
+                case QUICK_LAMBDA:
+                    result = evalLambda(args, frame);
+                    break;
+                case QUICK_LETSTAR:
+                    result = evalLetstar(args, frame);
+                    break;
+                case QUICK_LETREC:
+                    result = evalLetrec(args, frame);
+                    break;
+                case QUICK_SET:
+                    result = setBang(args, frame);
+                    break;
+                case QUICK_BEGIN:
+                    result = evalBegin(args, frame);
+                    break;
+                case QUICK_AND:
+                    result = evalAnd(args, frame);
+                    break;
+                case QUICK_OR:
+                    result = evalOr(args, frame);
+                    break;
+                case QUICK_COND:
+                    result = evalCond(args, frame);
+                    break;
+                case QUICK_DELAY:
+                    result = evalDelay(args, frame);
+                    break;
+                case QUICK_CONS_STREAM:
+                    result = evalConsStream(args, frame);
+                    break;
+                case QUICK_WITH_LIMITS:
+                    result = evalWithLimits(args, frame);
+                    break;
+                case QUICK_CALL:
+                case QUICK_GENERIC:
+                    result = evalCall(tree, frame);
+                    break;
+                default:
+                    result = evalSpecialized(tree, frame);
+                    break;
             }
+            leaveSite(outerSite);
             break;
         }
 
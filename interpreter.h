@@ -1,8 +1,42 @@
 #ifndef _INTERPRETER
 #define _INTERPRETER
 
+#include "value.h"
+#include "talloc.h"
+
 void interpret(Value *tree);
 Value *eval(Value *expr, Frame *frame);
 
+// Find the Value bound to name in frame or its ancestors; NULL if unbound.
+Value *lookUpName(char *name, Frame *frame);
+
+// Find the Value bound to symbol, with an evaluation error if it is unbound.
+Value *lookUpSymbol(Value *symbol, Frame *frame);
+
+// Apply a primitive or closure to the argc arguments in argv, or to the
+// arguments in the list args.
+Value *applyArray(Value *function, int argc, Value **argv);
+Value *apply(Value *function, Value *args);
+
+// Whether value counts as true: everything but #f does.
+int isTrue(Value *value);
+
+// Create a top-level frame with all the primitive functions bound in it.
+Frame *makeGlobalFrame();
+
+// Evaluate each top-level S-expression of tree in frame, printing the results.
+void interpretInFrame(Value *tree, Frame *frame);
+
+// Make frame the one load evaluates files in, for threads that don't go
+// through interpretInFrame.
+void setTopFrame(Frame *frame);
+
+// The primitive bound to name, or NULL if there is none.
+Primitive *findPrimitive(char *name);
+
+// Restrict set! to bindings that were allocated in region; NULL lifts the
+// restriction. Used when the frames around the program outlive its memory.
+void restrictSet(Region *region);
+
 #endif
 
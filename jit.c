@@ -0,0 +1,419 @@
+#include "jit.h"
+#include "interpreter.h"
+#include "linkedlist.h"
+#include "talloc.h"
+#include "governor.h"
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#define CODE_ARENA_SIZE (4 << 20)
+#define MAX_CODE 65536
+#define MAX_COMPILED 1024
+#define MAX_DEPENDENCIES 16
+
+// Native code takes its arguments as 8-byte slots with the last parameter
+// first, which is the order the code itself pushes them in for a self call,
+// and returns the integer result.
+typedef int (*NativeEntry)(int64_t *slots);
+
+struct Jit {
+    NativeEntry entry;
+    int paramCount;
+    // the names the code assumed the values of, checked before a run when
+    // bindings may have changed since they were last found intact
+    unsigned long checked;
+    int dependencyCount;
+    struct {
+        char *name;
+        Value *value;
+    } dependencies[MAX_DEPENDENCIES];
+};
+
+// Counts the defines, and the set!s of procedures, made by this thread: the
+// only ways a name code depends on can come to mean something else.
+static __thread unsigned long rebindings = 1;
+
+// shared by every closure whose body can't be compiled
+static struct Jit notCompiled;
+
+static struct Jit records[MAX_COMPILED];
+static int recordCount;
+
+// executable memory, filled from the front and never given back
+static unsigned char *arena;
+static size_t arenaUsed;
+
+// taken while compiling and while going over the records, which closures of
+// every thread share
+static pthread_mutex_t jitLock = PTHREAD_MUTEX_INITIALIZER;
+
+#if defined(__x86_64__)
+
+typedef struct {
+    unsigned char code[MAX_CODE];
+    size_t length;
+    int failed;
+    Value *closure;
+    struct Jit *jit;
+} Compiler;
+
+static Compiler compiler;
+
+static void emitByte(Compiler *c, int byte) {
+    if (c->length >= MAX_CODE) {
+        c->failed = 1;
+        return;
+    }
+    c->code[c->length++] = byte;
+}
+
+static void emit32(Compiler *c, int32_t word) {
+    for (int i = 0; i < 4; i++) {
+        emitByte(c, (uint32_t)word >> (8 * i));
+    }
+}
+
+// point the rel32 field at position at towards target
+static void patch(Compiler *c, size_t at, size_t target) {
+    if (c->failed) {
+        return;
+    }
+    int32_t rel = (int32_t)(target - (at + 4));
+    memcpy(c->code + at, &rel, 4);
+}
+
+// index of name among the closure's parameters, or -1
+static int paramIndex(Compiler *c, char *name) {
+    int index = 0;
+    for (Value *p = c->closure->cl.paramNames; !isNull(p); p = cdr(p)) {
+        if (!strcmp(car(p)->s, name)) {
+            return index;
+        }
+        index++;
+    }
+    return -1;
+}
+
+// Resolve the operator name the way the call would, and remember that the code
+// depends on it staying bound to the same value.
+static Value *resolve(Compiler *c, char *name) {
+    static char *specialForms[] = {"if", "let", "quote", "define", "lambda", "let*",
+                                   "letrec", "set!", "begin", "and", "or", "cond",
+                                   "delay", "cons-stream", "with-limits"};
+    for (size_t i = 0; i < sizeof(specialForms) / sizeof(specialForms[0]); i++) {
+        if (!strcmp(name, specialForms[i])) {
+            return NULL;
+        }
+    }
+    if (paramIndex(c, name) >= 0) {
+        return NULL;
+    }
+    Value *value = lookUpName(name, c->closure->cl.frame);
+    if (value == NULL) {
+        return NULL;
+    }
+
+    struct Jit *jit = c->jit;
+    for (int i = 0; i < jit->dependencyCount; i++) {
+        if (!strcmp(jit->dependencies[i].name, name)) {
+            return value;
+        }
+    }
+    if (jit->dependencyCount == MAX_DEPENDENCIES) {
+        return NULL;
+    }
+    // the symbol may be in a region that is freed before the code is next run
+    jit->dependencies[jit->dependencyCount].name = strdup(name);
+    jit->dependencies[jit->dependencyCount].value = value;
+    jit->dependencyCount++;
+    return value;
+}
+
+// name of the primitive a call's operator resolves to, or NULL
+static char *primitiveOperator(Compiler *c, Value *expr) {
+    if (expr->type != CONS_TYPE || car(expr)->type != SYMBOL_TYPE) {
+        return NULL;
+    }
+    Value *value = resolve(c, car(expr)->s);
+    if (value == NULL || value->type != PRIMITIVE_TYPE) {
+        return NULL;
+    }
+    return value->primitive->name;
+}
+
+static void compileExpression(Compiler *c, Value *expr);
+
+// Fold the arguments with op (add, sub or imul of ecx into eax), starting from
+// identity when there are none.
+static void compileArithmetic(Compiler *c, Value *args, int identity,
+                              unsigned char op1, unsigned char op2, int wide) {
+    if (isNull(args)) {
+        emitByte(c, 0xB8);                                  // mov eax, identity
+        emit32(c, identity);
+        return;
+    }
+    compileExpression(c, car(args));
+    for (args = cdr(args); !isNull(args); args = cdr(args)) {
+        emitByte(c, 0x50);                                  // push rax
+        compileExpression(c, car(args));
+        emitByte(c, 0x89); emitByte(c, 0xC1);               // mov ecx, eax
+        emitByte(c, 0x58);                                  // pop rax
+        emitByte(c, op1); emitByte(c, op2);
+        if (wide) {
+            emitByte(c, 0xC1);                              // imul eax, ecx
+        }
+    }
+}
+
+// Compile a comparison for an if, returning the opcode of the jump taken when
+// it is false (0 if it isn't a comparison the compiler handles).
+static int compileCondition(Compiler *c, Value *expr) {
+    char *name = primitiveOperator(c, expr);
+    int jump;
+    if (name == NULL) {
+        return 0;
+    } else if (!strcmp(name, "<")) {
+        jump = 0x8D;                                        // jge
+    } else if (!strcmp(name, ">")) {
+        jump = 0x8E;                                        // jle
+    } else if (!strcmp(name, "=")) {
+        jump = 0x85;                                        // jne
+    } else {
+        return 0;
+    }
+    Value *args = cdr(expr);
+    if (length(args) != 2) {
+        return 0;
+    }
+    compileExpression(c, car(args));
+    emitByte(c, 0x50);                                      // push rax
+    compileExpression(c, car(cdr(args)));
+    emitByte(c, 0x89); emitByte(c, 0xC1);                   // mov ecx, eax
+    emitByte(c, 0x58);                                      // pop rax
+    emitByte(c, 0x39); emitByte(c, 0xC8);                   // cmp eax, ecx
+    return jump;
+}
+
+// Emit code leaving the value of expr in eax.
+static void compileExpression(Compiler *c, Value *expr) {
+    if (c->failed) {
+        return;
+    }
+
+    if (expr->type == INT_TYPE) {
+        emitByte(c, 0xB8);                                  // mov eax, imm32
+        emit32(c, expr->i);
+        return;
+    }
+
+    if (expr->type == SYMBOL_TYPE) {
+        int index = paramIndex(c, expr->s);
+        if (index < 0) {
+            c->failed = 1;
+            return;
+        }
+        int slot = c->jit->paramCount - 1 - index;
+        emitByte(c, 0x8B); emitByte(c, 0x83);               // mov eax, [rbx + disp32]
+        emit32(c, 8 * slot);
+        return;
+    }
+
+    if (expr->type != CONS_TYPE || car(expr)->type != SYMBOL_TYPE) {
+        c->failed = 1;
+        return;
+    }
+    Value *args = cdr(expr);
+
+    if (!strcmp(car(expr)->s, "if")) {
+        if (length(args) != 3) {
+            c->failed = 1;
+            return;
+        }
+        int jump = compileCondition(c, car(args));
+        if (jump == 0) {
+            c->failed = 1;
+            return;
+        }
+        emitByte(c, 0x0F); emitByte(c, jump);               // jcc else
+        size_t toElse = c->length;
+        emit32(c, 0);
+        compileExpression(c, car(cdr(args)));
+        emitByte(c, 0xE9);                                  // jmp end
+        size_t toEnd = c->length;
+        emit32(c, 0);
+        patch(c, toElse, c->length);
+        compileExpression(c, car(cdr(cdr(args))));
+        patch(c, toEnd, c->length);
+        return;
+    }
+
+    Value *operator = resolve(c, car(expr)->s);
+    if (operator == c->closure) {
+        int count = length(args);
+        if (count != c->jit->paramCount) {
+            c->failed = 1;
+            return;
+        }
+        for (; !isNull(args); args = cdr(args)) {
+            compileExpression(c, car(args));
+            emitByte(c, 0x50);                              // push rax
+        }
+        emitByte(c, 0x48); emitByte(c, 0x89); emitByte(c, 0xE7); // mov rdi, rsp
+        emitByte(c, 0xE8);                                  // call entry
+        size_t toEntry = c->length;
+        emit32(c, 0);
+        patch(c, toEntry, 0);
+        if (count > 0) {
+            emitByte(c, 0x48); emitByte(c, 0x81); emitByte(c, 0xC4); // add rsp, imm32
+            emit32(c, 8 * count);
+        }
+        return;
+    }
+
+    char *name = primitiveOperator(c, expr);
+    if (name != NULL && !strcmp(name, "+")) {
+        compileArithmetic(c, args, 0, 0x01, 0xC8, 0);       // add eax, ecx
+    } else if (name != NULL && !strcmp(name, "*")) {
+        compileArithmetic(c, args, 1, 0x0F, 0xAF, 1);
+    } else if (name != NULL && !strcmp(name, "-") && length(args) == 2) {
+        compileArithmetic(c, args, 0, 0x29, 0xC8, 0);       // sub eax, ecx
+    } else {
+        c->failed = 1;
+    }
+}
+
+// copy code into executable memory, returning where it went (NULL if full)
+static void *install(unsigned char *code, size_t size) {
+    if (arena == NULL) {
+        void *map = mmap(NULL, CODE_ARENA_SIZE, PROT_READ | PROT_EXEC,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (map == MAP_FAILED) {
+            return NULL;
+        }
+        arena = map;
+    }
+    if (arenaUsed + size > CODE_ARENA_SIZE) {
+        return NULL;
+    }
+
+    uintptr_t page = sysconf(_SC_PAGESIZE);
+    unsigned char *start = arena + arenaUsed;
+    uintptr_t first = (uintptr_t)start & ~(page - 1);
+    uintptr_t last = ((uintptr_t)start + size + page - 1) & ~(page - 1);
+    if (mprotect((void *)first, last - first, PROT_READ | PROT_WRITE) != 0) {
+        return NULL;
+    }
+    memcpy(start, code, size);
+    mprotect((void *)first, last - first, PROT_READ | PROT_EXEC);
+
+    arenaUsed += (size + 15) & ~(size_t)15;
+    return start;
+}
+
+// Compile the body of closure to x86-64 code.
+static struct Jit *compile(Value *closure) {
+    if (recordCount == MAX_COMPILED) {
+        return &notCompiled;
+    }
+    struct Jit *jit = &records[recordCount];
+    memset(jit, 0, sizeof(*jit));
+    jit->paramCount = closureInfo(closure)->arity;
+
+    Compiler *c = &compiler;
+    c->length = 0;
+    c->failed = 0;
+    c->closure = closure;
+    c->jit = jit;
+
+    emitByte(c, 0x53);                                      // push rbx
+    emitByte(c, 0x48); emitByte(c, 0x89); emitByte(c, 0xFB); // mov rbx, rdi
+    compileExpression(c, car(closure->cl.functionCode));
+    emitByte(c, 0x5B);                                      // pop rbx
+    emitByte(c, 0xC3);                                      // ret
+
+    if (c->failed) {
+        return &notCompiled;
+    }
+    jit->entry = (NativeEntry)install(c->code, c->length);
+    if (jit->entry == NULL) {
+        return &notCompiled;
+    }
+    recordCount++;
+    return jit;
+}
+
+#else
+
+// Native code is only generated for x86-64.
+static struct Jit *compile(Value *closure) {
+    return &notCompiled;
+}
+
+#endif
+
+// Compile the body of closure to native code.
+struct Jit *compileClosure(Value *closure) {
+    pthread_mutex_lock(&jitLock);
+    struct Jit *jit = compile(closure);
+    pthread_mutex_unlock(&jitLock);
+    return jit;
+}
+
+// Run closure's native code on the argc arguments in argv.
+Value *runNative(Value *closure, int argc, Value **argv) {
+    struct Jit *jit = closureInfo(closure)->native;
+    if (jit->entry == NULL) {
+        return NULL;
+    }
+    if (jit->checked != rebindings) {
+        for (int i = 0; i < jit->dependencyCount; i++) {
+            if (lookUpName(jit->dependencies[i].name, closure->cl.frame) !=
+                jit->dependencies[i].value) {
+                return NULL;
+            }
+        }
+        jit->checked = rebindings;
+    }
+
+    if (argc != jit->paramCount) {
+        return NULL;
+    }
+    int64_t slots[jit->paramCount + 1];
+    for (int i = 0; i < argc; i++) {
+        if (argv[i]->type != INT_TYPE) {
+            return NULL;
+        }
+        slots[argc - 1 - i] = argv[i]->i;
+    }
+
+    Value *result = tallocKind(sizeof(Value), NUMBER_MEMORY);
+    result->type = INT_TYPE;
+    result->i = callNative(jit->entry, slots);
+    return result;
+}
+
+// Note that a name may have been rebound: by a define, or a set! of a binding
+// that held a procedure.
+void noteRebinding() {
+    rebindings++;
+}
+
+// Replace the value each compiled closure depends on with forward(value).
+// Only values that move are written, since the records of closures in other
+// threads are read by them as they run.
+void forwardNative(Value *(*forward)(Value *value)) {
+    pthread_mutex_lock(&jitLock);
+    for (int i = 0; i < recordCount; i++) {
+        for (int j = 0; j < records[i].dependencyCount; j++) {
+            Value *value = records[i].dependencies[j].value;
+            Value *moved = forward(value);
+            if (moved != value) {
+                records[i].dependencies[j].value = moved;
+            }
+        }
+    }
+    pthread_mutex_unlock(&jitLock);
+}
@@ -0,0 +1,33 @@
+#include "value.h"
+
+#ifndef _JIT
+#define _JIT
+
+// Number of calls after which apply compiles a closure to native code.
+#ifndef JIT_THRESHOLD
+#define JIT_THRESHOLD 64
+#endif
+
+// Compile the body of closure to x86-64 code. Bodies made of integer literals,
+// parameters, if on a comparison, the +, -, *, <, > and = primitives and calls
+// back to the closure itself are compiled; for anything else (or on other
+// machines) the returned record just says there is no native code, so the
+// closure isn't tried again.
+struct Jit *compileClosure(Value *closure);
+
+// Run closure's native code on the argc arguments in argv. Returns NULL when
+// the interpreter has to evaluate the call instead: there is no native code,
+// an argument isn't an integer, or a name the code was compiled against has
+// been rebound since.
+Value *runNative(Value *closure, int argc, Value **argv);
+
+// Note that a name may have been rebound: by a define, or a set! of a binding
+// that held a procedure. Until then native code skips checking the names it
+// was compiled against.
+void noteRebinding();
+
+// Replace the value each piece of native code depends on with forward(value),
+// for when the values are moved to another region.
+void forwardNative(Value *(*forward)(Value *value));
+
+#endif
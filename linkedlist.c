@@ -14,13 +14,62 @@ Value *makeNull(){
 
 // Create a new CONS_TYPE value node.
 Value *cons(Value *newCar, Value *newCdr) {
-    Value *newNode = talloc(sizeof(Value));
+    Value *newNode = tallocKind(CONS_SIZE, CONS_MEMORY);
     newNode->type = CONS_TYPE;
+    newNode->quick = 0;
     newNode->c.car = newCar;
     newNode->c.cdr = newCdr;
     return newNode;
 };
 
+// Number of bytes allocated for value.
+size_t valueSize(Value *value) {
+    switch (value->type) {
+        case CONS_TYPE:
+            return CONS_SIZE;
+        case CLOSURE_TYPE:
+            return CLOSURE_SIZE;
+        default:
+            return sizeof(Value);
+    }
+}
+
+// Longest run of cells makeList takes in one allocation, so that every run fits
+// in an ordinary chunk.
+#define RUN_LENGTH 1024
+
+// Lay out count cons cells in runs of side-by-side cells, noting in runs (if
+// it isn't NULL) where each run starts.
+static Value *makeRuns(int count, Value **runs) {
+    Value *list = makeNull();
+    Value **last = &list;
+    while (count > 0) {
+        int run = count < RUN_LENGTH ? count : RUN_LENGTH;
+        char *cells = tallocKind(run * CONS_SIZE, CONS_MEMORY);
+        if (runs != NULL) {
+            *runs++ = (Value *)cells;
+        }
+        for (int i = 0; i < run; i++) {
+            Value *cell = (Value *)(cells + i * CONS_SIZE);
+            cell->type = CONS_TYPE;
+            cell->quick = 0;
+            cell->c.car = NULL;
+            cell->c.cdr = NULL;
+            *last = cell;
+            last = &cell->c.cdr;
+        }
+        count -= run;
+    }
+    *last = makeNull();
+    return list;
+}
+
+// Create a list of count cons cells, laid out side by side in memory, whose
+// cars are left for the caller to fill in.
+Value *makeList(int count) {
+    return makeRuns(count, NULL);
+}
+
 // Display the contents of the linked list to the screen in some kind of
 // readable format
 void display(Value *list) { // do we need a temp pointer?
@@ -43,17 +92,21 @@ void display(Value *list) { // do we need a temp pointer?
     }
 };
 
-// Return a new list that is the reverse of the one that is passed in. All
-// content within the list should be duplicated; there should be no shared
-// memory whatsoever between the original list and the new one.
-//
-// FAQ: What if there are nested lists inside that list?
-// ANS: There won't be for this assignment. There will be later, but that will
-// be after we've got an easier way of managing memory.
+// Return a new list that is the reverse of the one that is passed in. No stored
+// data within the linked list should be duplicated; rather, a new linked list
+// of CONS_TYPE nodes should be created, that point to items in the original
+// list. The new cells are laid out side by side, as by makeList.
 Value *reverse(Value *list) {
-    Value *reversed = makeNull();
+    int count = length(list);
+    Value *runs[count / RUN_LENGTH + 1];
+    Value *reversed = makeRuns(count, runs);
+
+    // fill the cells in from the back
+    int position = count;
     while(list->type != NULL_TYPE){
-        reversed = cons(list->c.car, reversed);
+        position--;
+        char *run = (char *)runs[position / RUN_LENGTH];
+        ((Value *)(run + position % RUN_LENGTH * CONS_SIZE))->c.car = list->c.car;
         list = list->c.cdr;
     }
     return reversed;
@@ -1,4 +1,5 @@
 #include <stdbool.h>
+#include <stddef.h>
 #include "value.h"
 
 #ifndef _LINKEDLIST
@@ -10,6 +11,21 @@ Value *makeNull();
 // Create a new CONS_TYPE value node.
 Value *cons(Value *newCar, Value *newCdr);
 
+// A cons cell is only allocated as big as its type and its pair, not as a
+// whole Value, so anything that copies values has to copy valueSize bytes.
+#define CONS_SIZE (offsetof(Value, c) + sizeof(struct ConsCell))
+
+// The bytes an atom (a number, string, symbol, boolean or the empty list)
+// uses; atoms saved in datum files take only that much.
+#define ATOM_SIZE (offsetof(Value, d) + sizeof(double))
+
+// Number of bytes allocated for value.
+size_t valueSize(Value *value);
+
+// Create a list of count cons cells, laid out side by side in memory, whose
+// cars are left for the caller to fill in.
+Value *makeList(int count);
+
 // Display the contents of the linked list to the screen in some kind of
 // readable format
 void display(Value *list);
@@ -17,7 +33,7 @@ void display(Value *list);
 // Return a new list that is the reverse of the one that is passed in. No stored
 // data within the linked list should be duplicated; rather, a new linked list
 // of CONS_TYPE nodes should be created, that point to items in the original
-// list.
+// list. The new cells are laid out side by side, as by makeList.
 Value *reverse(Value *list);
 
 // Utility to make it less typing to get car value. Use assertions to make sure
@@ -0,0 +1,75 @@
+#include "load.h"
+#include "reader.h"
+#include "talloc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <sys/stat.h>
+
+// a file parsed before, and the version of it that was parsed
+typedef struct Module {
+    char *path;
+    struct timespec modified;
+    off_t size;
+    Value *tree;
+    struct Module *next;
+} Module;
+
+// each thread keeps the files it loaded to itself
+static __thread Module *modules;
+
+// parsed trees outlive the program (or server request) that loaded them
+static __thread Region *moduleRegion;
+
+Value *loadTree(char *path) {
+    struct stat info;
+    if (stat(path, &info) != 0) {
+        return NULL;
+    }
+
+    Module *module = modules;
+    while (module != NULL && strcmp(module->path, path)) {
+        module = module->next;
+    }
+    if (module != NULL && module->size == info.st_size &&
+        module->modified.tv_sec == info.st_mtim.tv_sec &&
+        module->modified.tv_nsec == info.st_mtim.tv_nsec) {
+        return module->tree;
+    }
+
+    FILE *stream = fopen(path, "r");
+    if (stream == NULL) {
+        return NULL;
+    }
+    if (moduleRegion == NULL) {
+        moduleRegion = newRegion();
+    }
+    // a syntax error mustn't leave moduleRegion current or the file open
+    Region *previous = useRegion(moduleRegion);
+    jmp_buf recovery;
+    jmp_buf *outer = setRecovery(&recovery);
+    int failed = setjmp(recovery);
+    Value *tree = NULL;
+    if (!failed) {
+        tree = readSource(stream, path);
+    }
+    setRecovery(outer);
+    useRegion(previous);
+    fclose(stream);
+    if (failed) {
+        texit(failed);
+    }
+
+    if (module == NULL) {
+        module = malloc(sizeof(Module));
+        module->path = strdup(path);
+        module->next = modules;
+        modules = module;
+    }
+    // the old tree stays in moduleRegion, since closures may still use it
+    module->modified = info.st_mtim;
+    module->size = info.st_size;
+    module->tree = tree;
+    return tree;
+}
@@ -0,0 +1,12 @@
+#include "value.h"
+
+#ifndef _LOAD
+#define _LOAD
+
+// Parse the Scheme file at path, or return the tree parsed for it before if
+// the file's modification time and size haven't changed since. Trees are kept
+// for the life of the process, in memory of their own. Returns NULL if the
+// file can't be opened.
+Value *loadTree(char *path);
+
+#endif
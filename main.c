@@ -1,17 +1,205 @@
 #include <stdio.h>
+#include <stdint.h>
+#include <string.h>
 #include "tokenizer.h"
 #include "value.h"
 #include "linkedlist.h"
 #include "parser.h"
 #include "talloc.h"
 #include "interpreter.h"
+#include "server.h"
+#include "image.h"
+#include "governor.h"
+#include "profile.h"
+#include "reader.h"
+#include "batch.h"
+#include "actor.h"
+#include "task.h"
 
-int main() {
+// Evaluate the Scheme file at path into frame, as a library for what follows.
+void loadPrelude(char *path, Frame *frame) {
+    FILE *stream = fopen(path, "r");
+    if (stream == NULL) {
+        fprintf(stderr, "Cannot open prelude %s\n", path);
+        texit(1);
+    }
+    Value *tree = readSource(stream, path);
+    fclose(stream);
+    interpretInFrame(tree, frame);
+}
+
+// Parse the program in the file at path. Unless useCache is 0, the tree is
+// also saved next to the source in path.cache, keyed by a hash of the source,
+// so that later runs on unchanged source map it back in instead of parsing.
+Value *readProgram(char *path, int useCache) {
+    FILE *stream = fopen(path, "rb");
+    if (stream == NULL) {
+        fprintf(stderr, "Cannot open %s\n", path);
+        texit(1);
+    }
+
+    // FNV-1a hash of the source
+    uint64_t hash = 14695981039346656037u;
+    char buffer[65536];
+    size_t got;
+    while ((got = fread(buffer, 1, sizeof(buffer), stream)) > 0) {
+        for (size_t i = 0; i < got; i++) {
+            hash = (hash ^ (unsigned char)buffer[i]) * 1099511628211u;
+        }
+    }
+
+    char *cachePath = talloc(strlen(path) + 7);
+    sprintf(cachePath, "%s.cache", path);
+    Value *tree = useCache ? readTree(cachePath, hash) : NULL;
+    if (tree == NULL) {
+        rewind(stream);
+        tree = readSource(stream, path);
+        if (useCache) {
+            writeTree(cachePath, tree, hash);
+        }
+    }
+    fclose(stream);
+    return tree;
+}
+
+// Run the interpreter as the command line says; returns the exit status.
+static int runInterpreter(int argc, char *argv[]) {
+    char *prelude = NULL;
+    char *socketPath = NULL;
+    char *image = NULL;
+    char *dumpImage = NULL;
+    char *program = NULL;
+    int useCache = 1;
+    int clearCache = 0;
+    char *heapProfile = NULL;
+    char *batch = NULL;
+    char *batchOutput = NULL;
+    int jobs = 0;
+    Limits limits = {0};
+
+    // error messages are printed with printf; keeping them in stdio's buffer
+    // until texit has written out the program's output before them keeps the
+    // two in the order they happened
+    setvbuf(stdout, NULL, _IOFBF, BUFSIZ);
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--prelude") && i + 1 < argc) {
+            prelude = argv[++i];
+        } else if (!strcmp(argv[i], "--serve") && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else if (!strcmp(argv[i], "--image") && i + 1 < argc) {
+            image = argv[++i];
+        } else if (!strcmp(argv[i], "--dump-image") && i + 1 < argc) {
+            dumpImage = argv[++i];
+        } else if (!strcmp(argv[i], "--max-steps") && i + 1 < argc) {
+            limits.steps = atol(argv[++i]);
+        } else if (!strcmp(argv[i], "--max-seconds") && i + 1 < argc) {
+            limits.seconds = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--max-depth") && i + 1 < argc) {
+            limits.depth = atol(argv[++i]);
+        } else if (!strcmp(argv[i], "--max-bytes") && i + 1 < argc) {
+            limits.bytes = strtoull(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--heap-profile") && i + 1 < argc) {
+            heapProfile = argv[++i];
+        } else if (!strcmp(argv[i], "--batch") && i + 1 < argc) {
+            batch = argv[++i];
+        } else if (!strcmp(argv[i], "--batch-output") && i + 1 < argc) {
+            batchOutput = argv[++i];
+        } else if (!strcmp(argv[i], "--jobs") && i + 1 < argc) {
+            jobs = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--reader-threads") && i + 1 < argc) {
+            setReaderThreads(atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--no-cache")) {
+            useCache = 0;
+        } else if (!strcmp(argv[i], "--clear-cache")) {
+            clearCache = 1;
+            useCache = 0;
+        } else if (argv[i][0] != '-' && program == NULL) {
+            program = argv[i];
+        } else {
+            fprintf(stderr, "Usage: %s [--prelude file | --image file] "
+                    "[--dump-image file] [--serve socket] "
+                    "[--batch directory-or-list [--batch-output directory] [--jobs n]] "
+                    "[--no-cache | --clear-cache] [--max-steps n] [--max-seconds s] "
+                    "[--max-depth n] [--max-bytes n] [--heap-profile file] "
+                    "[--reader-threads n] [file]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    if (clearCache && program != NULL) {
+        char *cachePath = talloc(strlen(program) + 7);
+        sprintf(cachePath, "%s.cache", program);
+        remove(cachePath);
+    }
 
-    Value *list = tokenize();
-    Value *tree = parse(list);
-    interpret(tree);
+    if (heapProfile != NULL) {
+        startHeapProfile(heapProfile);
+        // cached trees don't have positions
+        useCache = 0;
+    }
 
+    Frame *global;
+    if (image != NULL) {
+        global = readImage(image);
+        if (global == NULL) {
+            fprintf(stderr, "Cannot read image %s\n", image);
+            return 1;
+        }
+    } else {
+        global = makeGlobalFrame();
+    }
+    if (prelude != NULL) {
+        loadPrelude(prelude, global);
+    }
+
+    // save the environment built so far instead of running a program
+    if (dumpImage != NULL) {
+        int status = writeImage(dumpImage, global);
+        if (status != 0) {
+            fprintf(stderr, "Cannot write image %s\n", dumpImage);
+        }
+        tfree();
+        return status;
+    }
+
+    int status = 0;
+    if (socketPath != NULL) {
+        status = serve(socketPath, global, &limits);
+    } else if (batch != NULL) {
+        status = runBatch(batch, batchOutput, jobs, global, &limits);
+    } else if (program != NULL) {
+        Value *tree = readProgram(program, useCache);
+        setLimits(&limits);
+        interpretInFrame(tree, global);
+    } else {
+        Value *list = tokenize();
+        Value *tree = parse(list);
+        setLimits(&limits);
+        interpretInFrame(tree, global);
+    }
+
+    // the program is done once its tasks and actors are too
+    waitForTasks();
+    waitForActors();
     tfree();
-    return 0;
+    return status;
+}
+
+// the command line, and the exit status, of runMain
+static int mainArgc;
+static char **mainArgv;
+static int mainStatus;
+
+static void runMain() {
+    mainStatus = runInterpreter(mainArgc, mainArgv);
+}
+
+int main(int argc, char *argv[]) {
+    // loops are recursions, so programs get a stack as deep as a task's
+    mainArgc = argc;
+    mainArgv = argv;
+    runOnTaskStack(runMain);
+    return mainStatus;
 }
@@ -0,0 +1,199 @@
+#include "output.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#define OUTPUT_SIZE 65536
+
+// each thread has its own buffer, made when it first writes
+static __thread char *buffer;
+static __thread size_t used;
+static int registered;
+
+// Write out everything buffered so far.
+void flushOutput() {
+    size_t done = 0;
+    while (done < used) {
+        ssize_t written = write(STDOUT_FILENO, buffer + done, used - done);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            break;
+        }
+        done += written;
+    }
+    used = 0;
+}
+
+// Write out the calling thread's output and give back its buffer.
+void finishOutput() {
+    flushOutput();
+    free(buffer);
+    buffer = NULL;
+}
+
+// make room for count more bytes in the buffer
+static void reserve(size_t count) {
+    if (!__atomic_exchange_n(&registered, 1, __ATOMIC_RELAXED)) {
+        atexit(flushOutput);
+    }
+    if (buffer == NULL) {
+        buffer = malloc(OUTPUT_SIZE);
+    }
+    if (used + count > OUTPUT_SIZE) {
+        flushOutput();
+    }
+}
+
+// append count bytes, going around the buffer if they don't fit in it
+static void append(char *bytes, size_t count) {
+    reserve(count);
+    if (count > OUTPUT_SIZE) {
+        ssize_t ignored = write(STDOUT_FILENO, bytes, count);
+        (void)ignored;
+        return;
+    }
+    memcpy(buffer + used, bytes, count);
+    used += count;
+}
+
+// Append a string to the output.
+void outputString(char *text) {
+    append(text, strlen(text));
+}
+
+// Append one character to the output.
+void outputChar(char c) {
+    reserve(1);
+    buffer[used++] = c;
+}
+
+// Append an integer in decimal.
+void outputInt(int i) {
+    char digits[12];
+    int position = sizeof(digits);
+    unsigned int magnitude = i < 0 ? -(unsigned int)i : (unsigned int)i;
+    do {
+        digits[--position] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude > 0);
+    if (i < 0) {
+        digits[--position] = '-';
+    }
+    append(digits + position, sizeof(digits) - position);
+}
+
+
+// Append the decimal digits of n.
+static void outputWide(unsigned __int128 n) {
+    char digits[40];
+    int position = sizeof(digits);
+    do {
+        digits[--position] = '0' + (int)(n % 10);
+        n /= 10;
+    } while (n > 0);
+    append(digits + position, sizeof(digits) - position);
+}
+
+// Append the integer f * 2^shift, which may be far too big for any C type, by
+// peeling nine decimal digits at a time off an array of 32-bit words.
+static void outputHuge(uint64_t f, int shift) {
+    uint32_t words[34] = {0};
+    int count = shift / 32 + 3;
+    unsigned __int128 shifted = (unsigned __int128)f << (shift % 32);
+    for (int i = 0; i < 4; i++) {
+        words[shift / 32 + i] = (uint32_t)(shifted >> (32 * i));
+    }
+
+    uint32_t groups[40];
+    int groupCount = 0;
+    while (count > 0) {
+        uint64_t remainder = 0;
+        for (int i = count - 1; i >= 0; i--) {
+            uint64_t current = (remainder << 32) | words[i];
+            words[i] = (uint32_t)(current / 1000000000);
+            remainder = current % 1000000000;
+        }
+        groups[groupCount++] = (uint32_t)remainder;
+        while (count > 0 && words[count - 1] == 0) {
+            count--;
+        }
+    }
+
+    outputWide(groups[--groupCount]);
+    while (groupCount > 0) {
+        char digits[9];
+        uint32_t group = groups[--groupCount];
+        for (int i = 8; i >= 0; i--) {
+            digits[i] = '0' + group % 10;
+            group /= 10;
+        }
+        append(digits, 9);
+    }
+}
+
+// Append a double with six decimal places, rounded exactly the way printf's %f
+// rounds them (to nearest, ties to even).
+void outputDouble(double d) {
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    int negative = bits >> 63;
+    int biased = (bits >> 52) & 0x7FF;
+    uint64_t f = bits & (((uint64_t)1 << 52) - 1);
+
+    if (biased == 0x7FF) {
+        if (f != 0) {
+            outputString(negative ? "-nan" : "nan");
+        } else {
+            outputString(negative ? "-inf" : "inf");
+        }
+        return;
+    }
+    if (negative) {
+        outputChar('-');
+    }
+
+    // d is f * 2^e
+    int e;
+    if (biased == 0) {
+        e = -1074;
+    } else {
+        f |= (uint64_t)1 << 52;
+        e = biased - 1075;
+    }
+
+    if (e > 54) {
+        // an integer too big for the 128-bit path below
+        outputHuge(f, e);
+        outputString(".000000");
+        return;
+    }
+
+    // scaled is d * 10^6 rounded to an integer
+    unsigned __int128 scaled = (unsigned __int128)f * 1000000;
+    if (e >= 0) {
+        scaled <<= e;
+    } else if (e > -128) {
+        unsigned __int128 half = (unsigned __int128)1 << (-e - 1);
+        unsigned __int128 rest = scaled & ((half << 1) - 1);
+        scaled >>= -e;
+        if (rest > half || (rest == half && (scaled & 1))) {
+            scaled++;
+        }
+    } else {
+        scaled = 0;
+    }
+
+    outputWide(scaled / 1000000);
+    char fraction[7];
+    uint32_t part = (uint32_t)(scaled % 1000000);
+    fraction[0] = '.';
+    for (int i = 6; i >= 1; i--) {
+        fraction[i] = '0' + part % 10;
+        part /= 10;
+    }
+    append(fraction, 7);
+}
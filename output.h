@@ -0,0 +1,28 @@
+#ifndef _OUTPUT
+#define _OUTPUT
+
+// Program output is collected in a large buffer and handed to the operating
+// system in big writes instead of going through printf. The buffer is flushed
+// when it fills up and when the program exits. Each thread has its own.
+
+// Append a string to the output.
+void outputString(char *text);
+
+// Append one character to the output.
+void outputChar(char c);
+
+// Append an integer in decimal.
+void outputInt(int i);
+
+// Append a double with six decimal places, rounded exactly the way printf's %f
+// rounds them.
+void outputDouble(double d);
+
+// Write out everything buffered so far.
+void flushOutput();
+
+// Write out the calling thread's output and give back its buffer, for threads
+// that are about to end.
+void finishOutput();
+
+#endif
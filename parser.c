@@ -1,7 +1,10 @@
 #include "parser.h"
 #include "linkedlist.h"
 #include "talloc.h"
+#include "output.h"
+#include "source.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <assert.h>
 
 
@@ -15,17 +18,35 @@ Value *addToParseTree(Value *tree, int *depth, Value *token) {
     }
 
     else if (token->type == CLOSE_TYPE) { // close
-        Value *subtree = makeNull();
-        while (tree->type != NULL_TYPE && car(tree)->type != OPEN_TYPE) { // pop until reach open or end
-            subtree = cons(car(tree), subtree);
-            tree = cdr(tree);
+        int count = 0;
+        Value *open = tree;
+        while (open->type != NULL_TYPE && car(open)->type != OPEN_TYPE) { // find the open
+            count++;
+            open = cdr(open);
         }
         
-        if (tree->type == NULL_TYPE) { // no open found in main list
+        if (open->type == NULL_TYPE) { // no open found in main list
             printf("Syntax error: too many closed parentheses.\n");
             texit(1);
         } 
 
+        // pop into a list with its cells side by side
+        Value **items = malloc(count * sizeof(Value *));
+        for (int i = count - 1; i >= 0; i--) {
+            items[i] = car(tree);
+            tree = cdr(tree);
+        }
+        Value *subtree = makeList(count);
+        int i = 0;
+        for (Value *cell = subtree; !isNull(cell); cell = cdr(cell)) {
+            cell->c.car = items[i++];
+        }
+        free(items);
+        if (count > 0) {
+            // a list starts where its open parenthesis does
+            copyPosition(car(open), subtree);
+        }
+
         tree = cdr(tree); // pop open paren off
         tree = cons(subtree, tree); // add sublist to main list if reached open
         
@@ -66,54 +87,96 @@ Value *parse(Value *tokens) {
 };
 
 
+// Prints an f64vector as #f64( followed by its elements and a ).
+void printVector(Value *vector) {
+    outputString("#f64(");
+    for (int i = 0; i < vector->fv.length; i++) {
+        outputDouble(vector->fv.elements[i]);
+        outputChar(' ');
+    }
+    outputChar(')');
+}
+
+// print one element of a list that isn't itself a list
+static void printAtom(Value *value) {
+    switch (value->type) {
+        case INT_TYPE:
+            outputInt(value->i);
+            outputChar(' ');
+            break;
+        case DOUBLE_TYPE:
+            outputDouble(value->d);
+            outputChar(' ');
+            break;
+        case NULL_TYPE:
+            outputString("()");
+            break;
+        case CLOSURE_TYPE:
+        case PRIMITIVE_TYPE:
+            outputString("#<procedure> ");
+            break;
+        case PROMISE_TYPE:
+            outputString("#<promise> ");
+            break;
+        case F64VECTOR_TYPE:
+            printVector(value);
+            outputChar(' ');
+            break;
+        case PORT_TYPE:
+            outputString("#<port> ");
+            break;
+        case EOF_TYPE:
+            outputString("#<eof> ");
+            break;
+        case MACRO_TYPE:
+            outputString("#<macro> ");
+            break;
+        case ACTOR_TYPE:
+            outputString("#<actor> ");
+            break;
+        default:
+            outputString(value->s);
+            outputChar(' ');
+            break;
+    }
+}
+
 // Prints the tree to the screen in a readable fashion. It should look just like
-// Scheme code; use parentheses to indicate subtrees.
+// Scheme code; use parentheses to indicate subtrees. Sublists are walked with
+// an explicit stack of where to carry on in each enclosing list, so deeply
+// nested data can't overflow the C stack.
 void printTree(Value *tree) {
-    // printing everything in a linkedlist
-    while (tree->type != NULL_TYPE) {
-        if (tree->type != CONS_TYPE) {
-            printf(". ");
-            switch (tree->type) {
-                case INT_TYPE:
-                    printf("%i ", tree->i);
-                    break;
-                case DOUBLE_TYPE:
-                    printf("%f ", tree->d);
-                    break;
-                case CONS_TYPE:
-                    printf("(");
-                    printTree(tree);
-                    printf(") ");
-                    break;
-                case NULL_TYPE:
-                    printf("()");
-                    break;
-                default:
-                    printf("%s ", tree->s);
-                    break;
+    Value **pending = NULL;
+    int depth = 0;
+    int capacity = 0;
+    for (;;) {
+        if (tree->type == CONS_TYPE) {
+            Value *item = car(tree);
+            if (item->type != CONS_TYPE) {
+                printAtom(item);
+                tree = cdr(tree);
+                continue;
             }
-            return;
-        } else {
-            switch (car(tree)->type) {
-                case INT_TYPE:
-                    printf("%i ", car(tree)->i);
-                    break;
-                case DOUBLE_TYPE:
-                    printf("%f ", car(tree)->d);
-                    break;
-                case CONS_TYPE:
-                    printf("(");
-                    printTree(car(tree));
-                    printf(") ");
-                    break;
-                case NULL_TYPE:
-                    printf("()");
-                    break;
-                default:
-                    printf("%s ", car(tree)->s);
-                    break;
+            if (depth == capacity) {
+                capacity = capacity == 0 ? 64 : capacity * 2;
+                pending = realloc(pending, capacity * sizeof(Value *));
             }
-            tree = cdr(tree);
+            pending[depth++] = cdr(tree);
+            outputChar('(');
+            tree = item;
+            continue;
+        }
+
+        // end of a list, possibly improper
+        if (tree->type != NULL_TYPE) {
+            outputString(". ");
+            printAtom(tree);
+        }
+        if (depth == 0) {
+            break;
         }
+        outputString(") ");
+        tree = pending[--depth];
     }
-};
\ No newline at end of file
+    free(pending);
+}
\ No newline at end of file
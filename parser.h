@@ -12,5 +12,8 @@ Value *parse(Value *tokens);
 // Scheme code; use parentheses to indicate subtrees.
 void printTree(Value *tree);
 
+// Prints an f64vector as #f64( followed by its elements and a ).
+void printVector(Value *vector);
+
 
 #endif
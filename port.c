@@ -0,0 +1,250 @@
+#include "port.h"
+#include "task.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#define PORT_BUFFER_SIZE (256 * 1024)
+
+struct Port {
+    int fd;
+    int input;
+    int closed;
+    int atEnd;
+    // whether reading or writing may have to wait (a pipe or a terminal,
+    // not a regular file), which other tasks get to run through
+    int pollable;
+    // the unread input, or the unwritten output, is buffer[start..end)
+    char *buffer;
+    size_t start;
+    size_t end;
+    size_t capacity;
+    // output ports still open, flushed when the program exits
+    struct Port *nextOpen;
+};
+
+static Port *openOutputs;
+static int registered;
+static pthread_mutex_t openLock = PTHREAD_MUTEX_INITIALIZER;
+
+static Port *makePort(int fd, int input) {
+    Port *port = malloc(sizeof(Port));
+    port->fd = fd;
+    port->input = input;
+    port->closed = 0;
+    port->atEnd = 0;
+    struct stat info;
+    port->pollable = fstat(fd, &info) == 0 && !S_ISREG(info.st_mode);
+    port->capacity = PORT_BUFFER_SIZE;
+    port->buffer = malloc(port->capacity);
+    port->start = 0;
+    port->end = 0;
+    port->nextOpen = NULL;
+    return port;
+}
+
+// write all of bytes to port's file, as far as it will take them; if
+// mayWait, other tasks run whenever the file isn't ready to take more
+static void writeAll(Port *port, char *bytes, size_t length, int mayWait) {
+    int cooperate = mayWait && port->pollable && hasOtherTasks();
+    size_t done = 0;
+    while (done < length) {
+        size_t most = length - done;
+        if (cooperate) {
+            // a pipe that is ready takes at least this much without blocking
+            waitForFd(port->fd, 1);
+            most = most < PIPE_BUF ? most : PIPE_BUF;
+        }
+        ssize_t written = write(port->fd, bytes + done, most);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            break;
+        }
+        done += written;
+    }
+}
+
+// write out everything buffered in an output port
+static void flushPort(Port *port, int mayWait) {
+    writeAll(port, port->buffer + port->start, port->end - port->start, mayWait);
+    port->start = 0;
+    port->end = 0;
+}
+
+static void flushOpenOutputs() {
+    pthread_mutex_lock(&openLock);
+    // at exit, when tasks no longer get turns
+    for (Port *port = openOutputs; port != NULL; port = port->nextOpen) {
+        flushPort(port, 0);
+    }
+    pthread_mutex_unlock(&openLock);
+}
+
+Port *openInputPort(char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    return makePort(fd, 1);
+}
+
+Port *openOutputPort(char *path) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) {
+        return NULL;
+    }
+    Port *port = makePort(fd, 0);
+    pthread_mutex_lock(&openLock);
+    if (!registered) {
+        registered = 1;
+        atexit(flushOpenOutputs);
+    }
+    port->nextOpen = openOutputs;
+    openOutputs = port;
+    pthread_mutex_unlock(&openLock);
+    return port;
+}
+
+Port *standardInputPort() {
+    static Port *port;
+    pthread_mutex_lock(&openLock);
+    if (port == NULL) {
+        port = makePort(STDIN_FILENO, 1);
+    }
+    pthread_mutex_unlock(&openLock);
+    return port;
+}
+
+int isInputPort(Port *port) {
+    return port->input;
+}
+
+int isPortClosed(Port *port) {
+    return port->closed;
+}
+
+// Read more of the file into the buffer, after what is still unread, growing
+// the buffer if that already fills it. Returns 0 at the end of the file.
+static int fill(Port *port) {
+    if (port->atEnd || port->closed) {
+        return 0;
+    }
+    if (port->pollable) {
+        waitForFd(port->fd, 0);
+        if (port->closed) {
+            return 0;
+        }
+    }
+    if (port->start > 0) {
+        // keep the character before start, which portUnread may put back
+        size_t keep = port->start - 1;
+        memmove(port->buffer, port->buffer + keep, port->end - keep);
+        port->start -= keep;
+        port->end -= keep;
+    }
+    if (port->end == port->capacity) {
+        port->capacity *= 2;
+        port->buffer = realloc(port->buffer, port->capacity);
+    }
+    for (;;) {
+        ssize_t count = read(port->fd, port->buffer + port->end, port->capacity - port->end);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            port->atEnd = 1;
+            return 0;
+        }
+        port->end += count;
+        return 1;
+    }
+}
+
+int portRead(Port *port) {
+    if (port->start == port->end && !fill(port)) {
+        return EOF;
+    }
+    return (unsigned char)port->buffer[port->start++];
+}
+
+int portPeek(Port *port) {
+    if (port->start == port->end && !fill(port)) {
+        return EOF;
+    }
+    return (unsigned char)port->buffer[port->start];
+}
+
+void portUnread(Port *port) {
+    if (port->start > 0) {
+        port->start--;
+    }
+}
+
+char *portReadLine(Port *port, size_t *length) {
+    size_t scanned = 0;
+    for (;;) {
+        char *line = port->buffer + port->start;
+        char *newline = memchr(line + scanned, '\n', port->end - port->start - scanned);
+        if (newline != NULL) {
+            *length = newline - line;
+            port->start += *length + 1;
+            return line;
+        }
+        scanned = port->end - port->start;
+        if (!fill(port)) {
+            // the last line may not end in a newline
+            if (port->start == port->end) {
+                return NULL;
+            }
+            line = port->buffer + port->start;
+            *length = port->end - port->start;
+            port->start = port->end;
+            return line;
+        }
+    }
+}
+
+void portWrite(Port *port, char *bytes, size_t length) {
+    if (port->end + length > port->capacity) {
+        flushPort(port, 1);
+    }
+    if (length > port->capacity) {
+        writeAll(port, bytes, length, 1);
+        return;
+    }
+    memcpy(port->buffer + port->end, bytes, length);
+    port->end += length;
+}
+
+void closePort(Port *port) {
+    if (port->closed) {
+        return;
+    }
+    if (!port->input) {
+        flushPort(port, 1);
+        pthread_mutex_lock(&openLock);
+        for (Port **link = &openOutputs; *link != NULL; link = &(*link)->nextOpen) {
+            if (*link == port) {
+                *link = port->nextOpen;
+                break;
+            }
+        }
+        pthread_mutex_unlock(&openLock);
+    }
+    if (port->fd != STDIN_FILENO) {
+        close(port->fd);
+    }
+    port->closed = 1;
+    port->start = 0;
+    port->end = 0;
+    free(port->buffer);
+    port->buffer = NULL;
+}
@@ -0,0 +1,41 @@
+#include <stddef.h>
+
+#ifndef _PORT
+#define _PORT
+
+// A port reads from or writes to a file through a large buffer of its own, so
+// that scripts can stream through data files a line or a datum at a time.
+typedef struct Port Port;
+
+// Open the file at path for reading or writing (truncating it); NULL if it
+// can't be opened.
+Port *openInputPort(char *path);
+Port *openOutputPort(char *path);
+
+// A port reading from standard input.
+Port *standardInputPort();
+
+// Whether port was opened for input.
+int isInputPort(Port *port);
+
+// The next character of an input port, or EOF. portPeek doesn't consume it;
+// portUnread puts back the character just read.
+int portRead(Port *port);
+int portPeek(Port *port);
+void portUnread(Port *port);
+
+// The next line of an input port without its newline, as a pointer into the
+// port's buffer that stays valid until the port is read again. Returns NULL at
+// the end of the file.
+char *portReadLine(Port *port, size_t *length);
+
+// Write length bytes to an output port.
+void portWrite(Port *port, char *bytes, size_t length);
+
+// Flush an output port and close the file. Closing a closed port does nothing.
+void closePort(Port *port);
+
+// Whether port has been closed.
+int isPortClosed(Port *port);
+
+#endif
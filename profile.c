@@ -0,0 +1,159 @@
+#include "profile.h"
+#include "talloc.h"
+#include "source.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+// What has been allocated at one site for one kind of memory. The position
+// and the name of the operator are copied out of the expression, which may be
+// gone by the time the report is written.
+typedef struct Record {
+    Value *site;
+    MemoryKind kind;
+    int positioned;
+    Position position;
+    char operator[32];
+    long count;
+    size_t bytes;
+} Record;
+
+static char *reportPath;
+static __thread Value *currentSite;
+
+// records in an open-addressing table that doubles when half full
+static Record *records;
+static size_t capacity;
+static size_t recordCount;
+
+static char *kindNames[] = {"other", "frame", "cons", "number", "closure"};
+
+static size_t slotOf(Value *site, MemoryKind kind) {
+    uint64_t hash = (((uintptr_t)site >> 3) + kind) * 0x9E3779B97F4A7C15u;
+    return (hash >> 32) & (capacity - 1);
+}
+
+// find the record for site and kind, or the empty one where it would go
+static Record *lookUp(Value *site, MemoryKind kind) {
+    size_t slot = slotOf(site, kind);
+    while (records[slot].count != 0 &&
+           (records[slot].site != site || records[slot].kind != kind)) {
+        slot = (slot + 1) & (capacity - 1);
+    }
+    return &records[slot];
+}
+
+static void grow() {
+    Record *old = records;
+    size_t oldCapacity = capacity;
+    capacity = capacity == 0 ? 1024 : capacity * 2;
+    records = calloc(capacity, sizeof(Record));
+    for (size_t i = 0; i < oldCapacity; i++) {
+        if (old[i].count != 0) {
+            *lookUp(old[i].site, old[i].kind) = old[i];
+        }
+    }
+    free(old);
+}
+
+// the allocation hook: charge size bytes of kind to the current site
+static void charge(size_t size, MemoryKind kind) {
+    if (2 * (recordCount + 1) > capacity) {
+        grow();
+    }
+    Record *record = lookUp(currentSite, kind);
+    if (record->count == 0) {
+        recordCount++;
+        record->site = currentSite;
+        record->kind = kind;
+        if (currentSite != NULL) {
+            record->positioned = findPosition(currentSite, &record->position);
+            Value *operator = currentSite->c.car;
+            if (operator->type == SYMBOL_TYPE) {
+                snprintf(record->operator, sizeof(record->operator), "%s", operator->s);
+            }
+        }
+    }
+    record->count++;
+    record->bytes += size;
+}
+
+static int byBytes(const void *a, const void *b) {
+    const Record *x = a, *y = b;
+    if (x->bytes != y->bytes) {
+        return x->bytes < y->bytes ? 1 : -1;
+    }
+    return (x->count < y->count) - (x->count > y->count);
+}
+
+// Write the report: a symbol section naming each site, then the profile in
+// the heap profile text format, with one single-frame stack per site. Nothing
+// is followed to when it is freed, so the in-use figures are the allocated
+// ones.
+static void writeProfile() {
+    setAllocationHook(NULL);
+    FILE *report = fopen(reportPath, "w");
+    if (report == NULL) {
+        fprintf(stderr, "Cannot write heap profile %s\n", reportPath);
+        return;
+    }
+
+    Record *sorted = malloc((recordCount + 1) * sizeof(Record));
+    size_t n = 0;
+    long totalCount = 0;
+    size_t totalBytes = 0;
+    for (size_t i = 0; i < capacity; i++) {
+        if (records[i].count != 0) {
+            sorted[n++] = records[i];
+            totalCount += records[i].count;
+            totalBytes += records[i].bytes;
+        }
+    }
+    qsort(sorted, n, sizeof(Record), byBytes);
+
+    fprintf(report, "--- symbol\nbinary=interpreter\n");
+    for (size_t i = 0; i < n; i++) {
+        fprintf(report, "0x%016zx %s@", i + 1, kindNames[sorted[i].kind]);
+        if (sorted[i].positioned) {
+            fprintf(report, "%s:%u:%u(%s)", sourceFileName(sorted[i].position.file),
+                    sorted[i].position.line, sorted[i].position.column,
+                    sorted[i].operator);
+        } else {
+            fprintf(report, "<unknown>");
+        }
+        fprintf(report, "\n");
+    }
+    fprintf(report, "---\n--- heap\n");
+    fprintf(report, "heap profile: %6ld: %8zu [%6ld: %8zu] @ heapprofile\n",
+            totalCount, totalBytes, totalCount, totalBytes);
+    for (size_t i = 0; i < n; i++) {
+        fprintf(report, "%6ld: %8zu [%6ld: %8zu] @ 0x%016zx\n", sorted[i].count,
+                sorted[i].bytes, sorted[i].count, sorted[i].bytes, i + 1);
+    }
+    free(sorted);
+    fclose(report);
+}
+
+// Start profiling, with the report going to the file at path.
+void startHeapProfile(char *path) {
+    reportPath = path;
+    trackPositions();
+    setAllocationHook(charge);
+    atexit(writeProfile);
+}
+
+// Charge allocations to expr from now on, if it has a position.
+Value *enterSite(Value *expr) {
+    Value *outer = currentSite;
+    Position position;
+    if (reportPath != NULL && findPosition(expr, &position)) {
+        currentSite = expr;
+    }
+    return outer;
+}
+
+// Go back to charging allocations to site, as returned by enterSite.
+void leaveSite(Value *site) {
+    currentSite = site;
+}
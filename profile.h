@@ -0,0 +1,22 @@
+#include "value.h"
+
+#ifndef _PROFILE
+#define _PROFILE
+
+// The heap profiler charges every allocation to a site: the innermost
+// expression being evaluated that has a source position, together with the
+// kind of memory (frame, cons, number, closure or other). When the program
+// exits it writes the bytes and allocations of each site, biggest first, as a
+// symbolized heap profile that pprof reads.
+
+// Start profiling, with the report going to the file at path.
+void startHeapProfile(char *path);
+
+// Charge allocations to expr from now on, if it has a position. Returns the
+// site charged before, for leaveSite to go back to.
+Value *enterSite(Value *expr);
+
+// Go back to charging allocations to site, as returned by enterSite.
+void leaveSite(Value *site);
+
+#endif
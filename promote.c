@@ -0,0 +1,280 @@
+#include "promote.h"
+#include "talloc.h"
+#include "jit.h"
+#include "linkedlist.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum { VALUE_OBJECT, FRAME_OBJECT, STRING_OBJECT };
+
+// an object and what kind it is
+typedef struct {
+    void *object;
+    int kind;
+} Entry;
+
+// an object in the form region and its copy outside
+typedef struct {
+    void *from;
+    void *to;
+} Forward;
+
+// every thread that evaluates forms has its own form region
+static __thread Region *formRegion;
+static __thread Region *home;
+static __thread int active;
+
+// old objects changed during the form, as an open-addressing set
+static __thread Entry *remembered;
+static __thread size_t rememberedCapacity;
+static __thread size_t rememberedCount;
+
+// copies made so far while promoting, as an open-addressing table
+static __thread Forward *forwards;
+static __thread size_t forwardCapacity;
+static __thread size_t forwardCount;
+
+// copies whose fields still have to be promoted
+static __thread Entry *pending;
+static __thread size_t pendingCapacity;
+static __thread size_t pendingCount;
+
+static size_t slotFor(void *object, size_t capacity) {
+    uint64_t hash = (uintptr_t)object * 0x9E3779B97F4A7C15u;
+    return (hash ^ (hash >> 32)) & (capacity - 1);
+}
+
+// Start allocating from the form region.
+void beginForm() {
+    if (formRegion == NULL) {
+        formRegion = newRegion();
+    }
+    if (active) {
+        // the last form ended in an error that was recovered from
+        clearRegion(formRegion);
+        rememberedCount = 0;
+        memset(remembered, 0, rememberedCapacity * sizeof(Entry));
+    }
+    active = 1;
+    home = useRegion(formRegion);
+}
+
+int inForm(void *pointer) {
+    return active && pointer != NULL && inRegion(pointer, formRegion);
+}
+
+static void remember(void *object, int kind) {
+    if (!active || inRegion(object, formRegion)) {
+        return;
+    }
+    if ((rememberedCount + 1) * 2 > rememberedCapacity) {
+        Entry *old = remembered;
+        size_t oldCapacity = rememberedCapacity;
+        rememberedCapacity = oldCapacity ? oldCapacity * 2 : 64;
+        remembered = calloc(rememberedCapacity, sizeof(Entry));
+        for (size_t i = 0; i < oldCapacity; i++) {
+            if (old[i].object != NULL) {
+                size_t slot = slotFor(old[i].object, rememberedCapacity);
+                while (remembered[slot].object != NULL) {
+                    slot = (slot + 1) & (rememberedCapacity - 1);
+                }
+                remembered[slot] = old[i];
+            }
+        }
+        free(old);
+    }
+    size_t slot = slotFor(object, rememberedCapacity);
+    while (remembered[slot].object != NULL) {
+        if (remembered[slot].object == object) {
+            return;
+        }
+        slot = (slot + 1) & (rememberedCapacity - 1);
+    }
+    remembered[slot].object = object;
+    remembered[slot].kind = kind;
+    rememberedCount++;
+}
+
+void rememberFrame(Frame *frame) {
+    remember(frame, FRAME_OBJECT);
+}
+
+void rememberValue(Value *value) {
+    remember(value, VALUE_OBJECT);
+}
+
+static void *lookUpForward(void *from) {
+    if (forwardCapacity == 0) {
+        return NULL;
+    }
+    for (size_t slot = slotFor(from, forwardCapacity); forwards[slot].from != NULL;
+         slot = (slot + 1) & (forwardCapacity - 1)) {
+        if (forwards[slot].from == from) {
+            return forwards[slot].to;
+        }
+    }
+    return NULL;
+}
+
+static void addForward(void *from, void *to) {
+    if ((forwardCount + 1) * 2 > forwardCapacity) {
+        Forward *old = forwards;
+        size_t oldCapacity = forwardCapacity;
+        forwardCapacity = oldCapacity ? oldCapacity * 2 : 1024;
+        forwards = calloc(forwardCapacity, sizeof(Forward));
+        forwardCount = 0;
+        for (size_t i = 0; i < oldCapacity; i++) {
+            if (old[i].from != NULL) {
+                addForward(old[i].from, old[i].to);
+            }
+        }
+        free(old);
+    }
+    size_t slot = slotFor(from, forwardCapacity);
+    while (forwards[slot].from != NULL) {
+        slot = (slot + 1) & (forwardCapacity - 1);
+    }
+    forwards[slot].from = from;
+    forwards[slot].to = to;
+    forwardCount++;
+}
+
+// The copy of object outside the form region, made (and queued for its own
+// fields to be promoted) the first time it is asked for. Objects that aren't
+// in the form region are their own copy.
+static void *promote(void *object, int kind) {
+    if (object == NULL || !inRegion(object, formRegion)) {
+        return object;
+    }
+    void *copy = lookUpForward(object);
+    if (copy != NULL) {
+        return copy;
+    }
+
+    size_t size;
+    if (kind == STRING_OBJECT) {
+        size = strlen(object) + 1;
+    } else if (kind == FRAME_OBJECT) {
+        size = sizeof(Frame);
+    } else {
+        size = valueSize(object);
+    }
+    copy = talloc(size);
+    memcpy(copy, object, size);
+    addForward(object, copy);
+
+    if (kind != STRING_OBJECT) {
+        if (pendingCount == pendingCapacity) {
+            pendingCapacity = pendingCapacity ? pendingCapacity * 2 : 256;
+            pending = realloc(pending, pendingCapacity * sizeof(Entry));
+        }
+        pending[pendingCount].object = copy;
+        pending[pendingCount].kind = kind;
+        pendingCount++;
+    }
+    return copy;
+}
+
+// Point the fields of object, which is outside the form region, at promoted
+// copies.
+static void promoteFields(void *object, int kind) {
+    if (kind == FRAME_OBJECT) {
+        Frame *frame = object;
+        frame->bindings = promote(frame->bindings, VALUE_OBJECT);
+        frame->parent = promote(frame->parent, FRAME_OBJECT);
+        return;
+    }
+
+    Value *value = object;
+    switch (value->type) {
+        case STR_TYPE:
+        case SYMBOL_TYPE:
+        case BOOL_TYPE:
+        case OPEN_TYPE:
+        case CLOSE_TYPE:
+            value->s = promote(value->s, STRING_OBJECT);
+            break;
+        case CONS_TYPE:
+            value->c.car = promote(value->c.car, VALUE_OBJECT);
+            value->c.cdr = promote(value->c.cdr, VALUE_OBJECT);
+            break;
+        case CLOSURE_TYPE:
+            value->cl.paramNames = promote(value->cl.paramNames, VALUE_OBJECT);
+            value->cl.functionCode = promote(value->cl.functionCode, VALUE_OBJECT);
+            value->cl.frame = promote(value->cl.frame, FRAME_OBJECT);
+            break;
+        case PROMISE_TYPE:
+            value->pr.value = promote(value->pr.value, VALUE_OBJECT);
+            value->pr.code = promote(value->pr.code, VALUE_OBJECT);
+            value->pr.frame = promote(value->pr.frame, FRAME_OBJECT);
+            break;
+        case MACRO_TYPE:
+            value->mc.literals = promote(value->mc.literals, VALUE_OBJECT);
+            value->mc.rules = promote(value->mc.rules, VALUE_OBJECT);
+            break;
+        case UNSPECIFIED_TYPE:
+            value->p = promote(value->p, VALUE_OBJECT);
+            break;
+        case F64VECTOR_TYPE:
+            // the elements belong to this vector alone
+            if (inRegion(value->fv.elements, formRegion)) {
+                double *elements = talloc(value->fv.length * sizeof(double));
+                memcpy(elements, value->fv.elements, value->fv.length * sizeof(double));
+                value->fv.elements = elements;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// The promoted copy of a value native code depends on. Values that didn't
+// escape only belonged to closures that are gone, so they become NULL rather
+// than dangle.
+static Value *forwardDependency(Value *value) {
+    if (!inRegion(value, formRegion)) {
+        return value;
+    }
+    return lookUpForward(value);
+}
+
+// Promote what escaped from the form, free the rest and go back to the region
+// that was current when beginForm was called.
+void endForm() {
+    useRegion(home);
+    active = 0;
+
+    for (size_t i = 0; i < rememberedCapacity; i++) {
+        if (remembered[i].object != NULL) {
+            promoteFields(remembered[i].object, remembered[i].kind);
+        }
+    }
+    while (pendingCount > 0) {
+        Entry next = pending[--pendingCount];
+        promoteFields(next.object, next.kind);
+    }
+    forwardNative(forwardDependency);
+
+    clearRegion(formRegion);
+    if (rememberedCount > 0) {
+        memset(remembered, 0, rememberedCapacity * sizeof(Entry));
+        rememberedCount = 0;
+    }
+    if (forwardCount > 0) {
+        memset(forwards, 0, forwardCapacity * sizeof(Forward));
+        forwardCount = 0;
+    }
+}
+
+// Keep everything the form allocated, moving it into the region that was
+// current when beginForm was called, and go back to that region.
+void keepForm() {
+    useRegion(home);
+    active = 0;
+    mergeRegion(formRegion, home);
+    if (rememberedCount > 0) {
+        memset(remembered, 0, rememberedCapacity * sizeof(Entry));
+        rememberedCount = 0;
+    }
+}
@@ -0,0 +1,31 @@
+#include "value.h"
+
+#ifndef _PROMOTE
+#define _PROMOTE
+
+// Each top-level form is evaluated in a region of its own. When the form is
+// done, whatever it stored into longer-lived objects (a define into the
+// global frame, a set! of an outer binding, a forced promise) is copied, with
+// everything it reaches in the form's region, into the region that was
+// current before, and the form's region is freed wholesale.
+
+// Start allocating from the form region.
+void beginForm();
+
+// Promote what escaped from the form, free the rest and go back to the region
+// that was current when beginForm was called.
+void endForm();
+
+// Keep everything the form allocated instead, for when tasks that may still
+// be using any of it are left running.
+void keepForm();
+
+// Record that frame's bindings, or the fields of value (a cons cell, or a
+// promise), were changed to point at something possibly in the form region.
+void rememberFrame(Frame *frame);
+void rememberValue(Value *value);
+
+// Whether pointer is in the region of the form being evaluated.
+int inForm(void *pointer);
+
+#endif
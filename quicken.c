@@ -0,0 +1,135 @@
+#include "quicken.h"
+#include "talloc.h"
+#include <string.h>
+
+// the operations calls are specialized to, in the order of their kinds
+enum { ADD, SUBTRACT, MULTIPLY, LESS, GREATER, EQUAL };
+static char *operationNames[] = {"+", "-", "*", "<", ">", "="};
+#define OPERATION_COUNT 6
+
+static char *specialForms[] = {"if", "let", "quote", "define", "lambda", "let*",
+                               "letrec", "set!", "begin", "and", "or", "cond",
+                               "delay", "cons-stream", "with-limits"};
+
+// set once one of the operation names is bound to something else somewhere,
+// in any thread
+static int rebound;
+
+// index of name among the operation names, or -1
+static int operationIndex(char *name) {
+    for (int i = 0; i < OPERATION_COUNT; i++) {
+        if (!strcmp(name, operationNames[i])) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// The kind of a list in code whose first element is first.
+QuickKind classifyList(Value *first) {
+    if (first->type != SYMBOL_TYPE) {
+        return QUICK_CALL;
+    }
+    for (size_t i = 0; i < sizeof(specialForms) / sizeof(specialForms[0]); i++) {
+        if (!strcmp(first->s, specialForms[i])) {
+            return QUICK_IF + i;
+        }
+    }
+    return QUICK_CALL;
+}
+
+// What a call that has just been made is rewritten to.
+QuickKind specializeCall(Value *operatorName, Value *operator, int argc, Value **argv) {
+    if (__atomic_load_n(&rebound, __ATOMIC_RELAXED) || argc != 2 || operatorName->type != SYMBOL_TYPE ||
+        operator->type != PRIMITIVE_TYPE) {
+        return QUICK_GENERIC;
+    }
+    int operation = operationIndex(operatorName->s);
+    if (operation < 0 || strcmp(operator->primitive->name, operatorName->s)) {
+        return QUICK_GENERIC;
+    }
+    if (argv[0]->type == INT_TYPE && argv[1]->type == INT_TYPE) {
+        return QUICK_FIXNUM + operation;
+    }
+    if (argv[0]->type == DOUBLE_TYPE && argv[1]->type == DOUBLE_TYPE) {
+        return QUICK_FLONUM + operation;
+    }
+    return QUICK_GENERIC;
+}
+
+static Value *makeBoolean(int truth) {
+    Value *result = talloc(sizeof(Value));
+    result->type = BOOL_TYPE;
+    result->s = truth ? "#t" : "#f";
+    return result;
+}
+
+// The result of the specialized call kind on a and b, computed the way the
+// primitive would, or NULL if the call doesn't fit it any more.
+Value *runSpecialized(QuickKind kind, Value *a, Value *b) {
+    if (__atomic_load_n(&rebound, __ATOMIC_RELAXED)) {
+        return NULL;
+    }
+    if (kind < QUICK_FLONUM) {
+        if (a->type != INT_TYPE || b->type != INT_TYPE) {
+            return NULL;
+        }
+        // integer arithmetic wraps around like machine arithmetic
+        unsigned int x = a->i, y = b->i;
+        switch (kind - QUICK_FIXNUM) {
+            case LESS:
+                return makeBoolean(a->i < b->i);
+            case GREATER:
+                return makeBoolean(a->i > b->i);
+            case EQUAL:
+                return makeBoolean(a->i == b->i);
+        }
+        Value *result = tallocKind(sizeof(Value), NUMBER_MEMORY);
+        result->type = INT_TYPE;
+        switch (kind - QUICK_FIXNUM) {
+            case ADD:
+                result->i = (int)(x + y);
+                break;
+            case SUBTRACT:
+                result->i = (int)(x - y);
+                break;
+            default:
+                result->i = (int)(x * y);
+                break;
+        }
+        return result;
+    }
+
+    if (a->type != DOUBLE_TYPE || b->type != DOUBLE_TYPE) {
+        return NULL;
+    }
+    switch (kind - QUICK_FLONUM) {
+        case LESS:
+            return makeBoolean(a->d < b->d);
+        case GREATER:
+            return makeBoolean(a->d > b->d);
+        case EQUAL:
+            return makeBoolean(a->d == b->d);
+    }
+    Value *result = tallocKind(sizeof(Value), NUMBER_MEMORY);
+    result->type = DOUBLE_TYPE;
+    switch (kind - QUICK_FLONUM) {
+        case ADD:
+            result->d = a->d + b->d;
+            break;
+        case SUBTRACT:
+            result->d = a->d - b->d;
+            break;
+        default:
+            result->d = a->d * b->d;
+            break;
+    }
+    return result;
+}
+
+// Note that name is being bound or assigned somewhere.
+void noteBinding(char *name) {
+    if (operationIndex(name) >= 0) {
+        __atomic_store_n(&rebound, 1, __ATOMIC_RELAXED);
+    }
+}
@@ -0,0 +1,49 @@
+#include "value.h"
+
+#ifndef _QUICKEN
+#define _QUICKEN
+
+// Quickening: eval records what it learns about each list in code in the
+// list's quick field, and the next evaluation of the list goes straight to
+// the code for it. Lists start out unseen; the first evaluation finds which
+// special form the list is, or that it is a call. After its first run a call
+// of +, -, *, <, > or = on two integers, or on two doubles, is rewritten into
+// a form specialized to them, which skips looking up the operator and checks
+// only the operands' types. When a check fails the call goes back to the
+// generic path for good.
+typedef enum {
+    QUICK_UNSEEN,
+    QUICK_IF, QUICK_LET, QUICK_QUOTE, QUICK_DEFINE, QUICK_LAMBDA, QUICK_LETSTAR,
+    QUICK_LETREC, QUICK_SET, QUICK_BEGIN, QUICK_AND, QUICK_OR, QUICK_COND,
+    QUICK_DELAY, QUICK_CONS_STREAM, QUICK_WITH_LIMITS,
+    // a call that may still be specialized after it runs
+    QUICK_CALL,
+    // a call that stays on the generic path
+    QUICK_GENERIC,
+    // the rest of a lambda form, (body), once its body has been expanded
+    QUICK_EXPANDED,
+    // the specialized calls: an operation on two integers or on two doubles
+    QUICK_FIXNUM,
+    QUICK_FLONUM = QUICK_FIXNUM + 6,
+    QUICK_END = QUICK_FLONUM + 6
+} QuickKind;
+
+// The kind of a list in code whose first element is first: the special form
+// it names, or QUICK_CALL.
+QuickKind classifyList(Value *first);
+
+// What a call through the symbol operatorName to operator, which has just
+// been made on the argc arguments in argv, is rewritten to: a specialized
+// call if it fits one, QUICK_GENERIC otherwise.
+QuickKind specializeCall(Value *operatorName, Value *operator, int argc, Value **argv);
+
+// The result of the specialized call kind on a and b, or NULL if they aren't
+// of the type it was specialized to or its operator may have been rebound.
+Value *runSpecialized(QuickKind kind, Value *a, Value *b);
+
+// Note that name is being bound or assigned somewhere. Once one of the names
+// of the specialized operations is, specialized calls stop trusting that it
+// still means the primitive.
+void noteBinding(char *name);
+
+#endif
@@ -0,0 +1,170 @@
+#include "reader.h"
+#include "tokenizer.h"
+#include "parser.h"
+#include "linkedlist.h"
+#include "talloc.h"
+#include "source.h"
+#include <stdlib.h>
+#include <setjmp.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Files smaller than this are read on one thread, as are pieces.
+#define PIECE_SIZE (1 << 20)
+#define MAX_THREADS 64
+
+// One piece of the file, read on a thread of its own.
+typedef struct Piece {
+    char *text;
+    size_t length;
+    Region *region;
+    Value *forms;
+    char *error;
+} Piece;
+
+static int threadLimit;
+
+// Read with at most count threads; 0 means one per processor.
+void setReaderThreads(int count) {
+    threadLimit = count;
+}
+
+// Find where to split the length characters of text into at most count
+// pieces, storing the start of each in starts and returning how many there
+// are. Pieces start at a space or newline outside any list, string or
+// comment. Returns 0 if the text isn't balanced, so that reading it in one go
+// reports the error.
+static int split(char *text, size_t length, int count, size_t *starts) {
+    int pieces = 1;
+    starts[0] = 0;
+    long depth = 0;
+    size_t i = 0;
+    while (i < length) {
+        char c = text[i];
+        if (c == '"') {
+            do {
+                i++;
+            } while (i < length && text[i] != '"');
+            if (i == length) {
+                return 0;
+            }
+        } else if (c == ';') {
+            while (i < length && text[i] != '\n') {
+                i++;
+            }
+            continue;
+        } else if (c == '(') {
+            depth++;
+        } else if (c == ')') {
+            if (--depth < 0) {
+                return 0;
+            }
+        } else if (depth == 0 && (c == ' ' || c == '\n') && pieces < count &&
+                   i >= pieces * (length / count)) {
+            starts[pieces++] = i;
+        }
+        i++;
+    }
+    return depth == 0 ? pieces : 0;
+}
+
+static void *readPiece(void *data) {
+    Piece *piece = data;
+    jmp_buf recovery;
+    useRegion(piece->region);
+    holdSyntaxErrors(&piece->error);
+    if (setjmp(recovery) == 0) {
+        setRecovery(&recovery);
+        piece->forms = parse(tokenizeText(piece->text, piece->length, NULL));
+    }
+    setRecovery(NULL);
+    holdSyntaxErrors(NULL);
+    return NULL;
+}
+
+// Read the pieces of text on threads, and join their forms into one list.
+// Returns NULL if the text has to be read in one go instead.
+static Value *readParallel(char *text, size_t length, int threads) {
+    size_t starts[MAX_THREADS];
+    int count = split(text, length, threads, starts);
+    if (count < 2) {
+        return NULL;
+    }
+
+    Piece pieces[MAX_THREADS];
+    pthread_t workers[MAX_THREADS];
+    int started = 0;
+    for (int i = 0; i < count; i++) {
+        size_t end = i + 1 < count ? starts[i + 1] : length;
+        pieces[i].text = text + starts[i];
+        pieces[i].length = end - starts[i];
+        pieces[i].region = newRegion();
+        pieces[i].forms = NULL;
+        pieces[i].error = NULL;
+        if (pthread_create(&workers[i], NULL, readPiece, &pieces[i]) != 0) {
+            break;
+        }
+        started++;
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+
+    // hand everything over to the current region before anything else, so
+    // that it is freed along with it whatever happens next
+    Region *home = useRegion(pieces[0].region); // finding out which is current
+    useRegion(home);
+    for (int i = 0; i < started; i++) {
+        mergeRegion(pieces[i].region, home);
+    }
+    if (started < count) {
+        return NULL;
+    }
+
+    Value *forms = NULL;
+    Value **last = &forms;
+    for (int i = 0; i < count; i++) {
+        if (pieces[i].forms == NULL) {
+            printf("%s\n", pieces[i].error != NULL ? pieces[i].error
+                                                   : "Syntax error: unreadable input");
+            texit(1);
+        }
+        *last = pieces[i].forms;
+        while ((*last)->type == CONS_TYPE) {
+            last = &(*last)->c.cdr;
+        }
+    }
+    return forms;
+}
+
+// Tokenize and parse the whole file open as stream, called name.
+Value *readSource(FILE *stream, char *name) {
+    int threads = threadLimit > 0 ? threadLimit : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads > MAX_THREADS) {
+        threads = MAX_THREADS;
+    }
+    struct stat info;
+    // positions and the heap profile aren't kept by more than one thread, and
+    // a memory limit can't be enforced from a reader thread
+    if (threads < 2 || isTrackingPositions() || isAllocationLimited() ||
+        fstat(fileno(stream), &info) != 0 || info.st_size < 2 * PIECE_SIZE) {
+        return parse(tokenizeStream(stream, name));
+    }
+    if (threads > info.st_size / PIECE_SIZE) {
+        threads = info.st_size / PIECE_SIZE;
+    }
+
+    size_t length = info.st_size;
+    char *text = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fileno(stream), 0);
+    if (text == MAP_FAILED) {
+        return parse(tokenizeStream(stream, name));
+    }
+    Value *forms = readParallel(text, length, threads);
+    munmap(text, length);
+    if (forms == NULL) {
+        return parse(tokenizeStream(stream, name));
+    }
+    return forms;
+}
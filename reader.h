@@ -0,0 +1,17 @@
+#include <stdio.h>
+#include "value.h"
+
+#ifndef _READER
+#define _READER
+
+// Tokenize and parse the whole file open as stream, called name, from its
+// start. Large files are split at top-level datum boundaries and the pieces
+// read on threads of their own, each into a region of its own that is then
+// handed over to the current region; the forms come back in source order, and
+// syntax errors are reported as if the file had been read in one go.
+Value *readSource(FILE *stream, char *name);
+
+// Read with at most count threads; 0 (the default) means one per processor.
+void setReaderThreads(int count);
+
+#endif
@@ -0,0 +1,181 @@
+#include "server.h"
+#include "tokenizer.h"
+#include "parser.h"
+#include "interpreter.h"
+#include "linkedlist.h"
+#include "talloc.h"
+#include "output.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// read exactly length bytes from fd; returns 0 if the peer went away first
+static int readFully(int fd, char *buffer, size_t length) {
+    while (length > 0) {
+        ssize_t got = read(fd, buffer, length);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            return 0;
+        }
+        buffer += got;
+        length -= got;
+    }
+    return 1;
+}
+
+// write all length bytes to the socket fd; returns 0 if the peer went away
+static int writeFully(int fd, char *buffer, size_t length) {
+    while (length > 0) {
+        ssize_t sent = send(fd, buffer, length, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent < 0) {
+            return 0;
+        }
+        buffer += sent;
+        length -= sent;
+    }
+    return 1;
+}
+
+// make sure *buffer can hold length bytes
+static void reserve(char **buffer, size_t *capacity, size_t length) {
+    if (length > *capacity) {
+        *capacity = length;
+        *buffer = realloc(*buffer, *capacity);
+    }
+}
+
+// Evaluate one program in a child frame of base, allocating from region and
+// printing into output. Errors jump back here through texit's recovery point.
+int runProgram(char *program, size_t length, Frame *base, Limits *limits,
+               Region *region, int output, int console) {
+    jmp_buf recovery;
+    FILE * volatile stream = NULL;
+    Region *previous = useRegion(region);
+    restrictSet(region);
+
+    flushOutput();
+    fflush(stdout);
+    dup2(output, STDOUT_FILENO);
+
+    int status = setjmp(recovery);
+    if (status == 0) {
+        setRecovery(&recovery);
+        setLimits(limits);
+        stream = fmemopen(program, length, "r");
+        // the tree is freed with the request, so no positions are kept for it
+        Value *tree = parse(tokenizeStream(stream, NULL));
+
+        Frame *frame = tallocKind(sizeof(Frame), FRAME_MEMORY);
+        frame->parent = base;
+        frame->bindings = makeNull();
+        interpretInFrame(tree, frame);
+    }
+    setRecovery(NULL);
+    setLimits(NULL);
+
+    if (stream != NULL) {
+        fclose(stream);
+    }
+    flushOutput();
+    fflush(stdout);
+    dup2(console, STDOUT_FILENO);
+
+    restrictSet(NULL);
+    useRegion(previous);
+    clearRegion(region);
+    return status;
+}
+
+// Listen on the Unix domain socket at path and evaluate the programs sent to
+// it, one after another, on top of the bindings in base.
+int serve(char *path, Frame *base, Limits *limits) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Server error: socket path too long.\n");
+        return 1;
+    }
+    strcpy(address.sun_path, path);
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path);
+    if (listener < 0 ||
+        bind(listener, (struct sockaddr *)&address, sizeof(address)) < 0 ||
+        listen(listener, 16) < 0) {
+        fprintf(stderr, "Server error: cannot listen on %s: %s\n", path, strerror(errno));
+        if (listener >= 0) {
+            close(listener);
+        }
+        return 1;
+    }
+
+    FILE *captureFile = tmpfile();
+    int capture = fileno(captureFile);
+    int console = dup(STDOUT_FILENO);
+    Region *region = newRegion();
+
+    char *request = NULL, *reply = NULL;
+    size_t requestCapacity = 0, replyCapacity = 0;
+    int running = 1;
+
+    while (running) {
+        int client = accept(listener, NULL, NULL);
+        if (client < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        unsigned char header[4];
+        while (readFully(client, (char *)header, 4)) {
+            size_t length = (uint32_t)header[0] << 24 | (uint32_t)header[1] << 16 |
+                            (uint32_t)header[2] << 8 | header[3];
+            if (length == 0) {
+                running = 0;
+                break;
+            }
+            reserve(&request, &requestCapacity, length);
+            if (!readFully(client, request, length)) {
+                break;
+            }
+
+            ftruncate(capture, 0);
+            lseek(capture, 0, SEEK_SET);
+            runProgram(request, length, base, limits, region, capture, console);
+
+            off_t end = lseek(capture, 0, SEEK_END);
+            reserve(&reply, &replyCapacity, end);
+            ssize_t got = pread(capture, reply, end, 0);
+            size_t produced = got > 0 ? got : 0;
+
+            header[0] = produced >> 24;
+            header[1] = produced >> 16;
+            header[2] = produced >> 8;
+            header[3] = produced;
+            if (!writeFully(client, (char *)header, 4) ||
+                !writeFully(client, reply, produced)) {
+                break;
+            }
+        }
+        close(client);
+    }
+
+    free(request);
+    free(reply);
+    close(console);
+    fclose(captureFile);
+    close(listener);
+    unlink(path);
+    return 0;
+}
@@ -0,0 +1,27 @@
+#include "value.h"
+#include "governor.h"
+#include "talloc.h"
+
+#ifndef _SERVER
+#define _SERVER
+
+// Listen on the Unix domain socket at path and evaluate the programs sent to
+// it, one after another, on top of the bindings in base. A request is a 4-byte
+// big-endian length followed by that many bytes of Scheme source; the reply is
+// framed the same way and holds everything the program printed. Each request
+// runs in a child frame of base with its own memory, which is thrown away once
+// the reply is sent, so an error only ends the request that caused it. A
+// request of length 0 stops the server. Each request is evaluated under
+// limits. Returns nonzero if the socket could not be set up.
+int serve(char *path, Frame *base, Limits *limits);
+
+// Evaluate the length bytes of Scheme source in program in a child frame of
+// base, under limits, with everything it prints going to the file descriptor
+// output; standard output is pointed back at console afterwards. Memory comes
+// from region, which is cleared at the end, and set! can't change bindings
+// outside it. Returns 0 if the program ran to the end and nonzero if an error
+// ended it.
+int runProgram(char *program, size_t length, Frame *base, Limits *limits,
+               Region *region, int output, int console);
+
+#endif
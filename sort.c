@@ -0,0 +1,266 @@
+#include "sort.h"
+#include "interpreter.h"
+#include "linkedlist.h"
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+
+// most sublists a parallel sort splits a list into
+#define MAX_SORT_THREADS 8
+// sorted runs of up to 2^RUN_BINS elements; enough for any list in memory
+#define RUN_BINS 64
+
+// how two elements are compared
+typedef enum { COMPARE_CALL, COMPARE_LESS, COMPARE_GREATER } Comparison;
+
+// A sublist for the pool to sort. The cells of sublists are linked by their
+// cdrs and ended by NULL until the sort is over.
+typedef struct Job {
+    Value *list;
+    Comparison how;
+    Value *sorted;
+    int done;
+    struct Job *next;
+} Job;
+
+static pthread_mutex_t poolLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t jobQueued = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t jobFinished = PTHREAD_COND_INITIALIZER;
+static Job *queueHead;
+static Job *queueTail;
+static int workerCount;
+
+static double numberOf(Value *number) {
+    return number->type == INT_TYPE ? number->i : number->d;
+}
+
+// whether a goes before b
+static int before(Value *a, Value *b, Comparison how, Value *less) {
+    switch (how) {
+        case COMPARE_LESS:
+            return numberOf(a) < numberOf(b);
+        case COMPARE_GREATER:
+            return numberOf(a) > numberOf(b);
+        default: {
+            Value *args[2] = {a, b};
+            return isTrue(applyArray(less, 2, args));
+        }
+    }
+}
+
+// Merge the sorted lists left and right, taking from left on ties so that the
+// sort is stable.
+static Value *merge(Value *left, Value *right, Comparison how, Value *less) {
+    Value *head = NULL;
+    Value **last = &head;
+    while (left != NULL && right != NULL) {
+        if (before(right->c.car, left->c.car, how, less)) {
+            *last = right;
+            last = &right->c.cdr;
+            right = right->c.cdr;
+        } else {
+            *last = left;
+            last = &left->c.cdr;
+            left = left->c.cdr;
+        }
+    }
+    *last = left != NULL ? left : right;
+    return head;
+}
+
+// Sort list bottom-up: bin i holds a sorted run of 2^i elements that came
+// before those of the lower bins, and each element taken off the list is
+// carried up through the full bins like a binary counter.
+static Value *sortRun(Value *list, Comparison how, Value *less) {
+    Value *bins[RUN_BINS] = {NULL};
+    int used = 0;
+    while (list != NULL) {
+        Value *carry = list;
+        list = list->c.cdr;
+        carry->c.cdr = NULL;
+        int i = 0;
+        while (i < used && bins[i] != NULL) {
+            carry = merge(bins[i], carry, how, less);
+            bins[i] = NULL;
+            i++;
+        }
+        bins[i] = carry;
+        if (i == used) {
+            used++;
+        }
+    }
+    Value *sorted = NULL;
+    for (int i = 0; i < used; i++) {
+        if (bins[i] != NULL) {
+            sorted = merge(bins[i], sorted, how, less);
+        }
+    }
+    return sorted;
+}
+
+// THE POOL
+
+// the next queued job, or NULL; poolLock must be held
+static Job *takeJob() {
+    Job *job = queueHead;
+    if (job != NULL) {
+        queueHead = job->next;
+        if (queueHead == NULL) {
+            queueTail = NULL;
+        }
+    }
+    return job;
+}
+
+static void runJob(Job *job) {
+    job->sorted = sortRun(job->list, job->how, NULL);
+    pthread_mutex_lock(&poolLock);
+    job->done = 1;
+    pthread_cond_broadcast(&jobFinished);
+    pthread_mutex_unlock(&poolLock);
+}
+
+static void *runWorker(void *unused) {
+    for (;;) {
+        pthread_mutex_lock(&poolLock);
+        Job *job;
+        while ((job = takeJob()) == NULL) {
+            pthread_cond_wait(&jobQueued, &poolLock);
+        }
+        pthread_mutex_unlock(&poolLock);
+        runJob(job);
+    }
+    return NULL;
+}
+
+// Make sure the pool has count workers, as far as threads can be started;
+// poolLock must be held.
+static void growPool(int count) {
+    // the timer signal is for the main thread's native code
+    sigset_t alarm, previous;
+    sigemptyset(&alarm);
+    sigaddset(&alarm, SIGALRM);
+    pthread_sigmask(SIG_BLOCK, &alarm, &previous);
+    while (workerCount < count) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, runWorker, NULL) != 0) {
+            break;
+        }
+        pthread_detach(thread);
+        workerCount++;
+    }
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+}
+
+// Sort list, of length elements, as count sublists on the pool. The calling
+// thread sorts the first sublist, then helps with any the workers haven't
+// taken, so the sort finishes even if no worker could be started.
+static Value *sortParallel(Value *list, long length, int count, Comparison how) {
+    Job jobs[MAX_SORT_THREADS];
+    for (int i = 0; i < count; i++) {
+        jobs[i].list = list;
+        jobs[i].how = how;
+        jobs[i].done = 0;
+        jobs[i].next = NULL;
+        long size = length / count + (i < length % count);
+        for (long j = 1; j < size; j++) {
+            list = list->c.cdr;
+        }
+        Value *rest = list->c.cdr;
+        list->c.cdr = NULL;
+        list = rest;
+    }
+
+    pthread_mutex_lock(&poolLock);
+    growPool(count - 1);
+    for (int i = 1; i < count; i++) {
+        if (queueTail == NULL) {
+            queueHead = &jobs[i];
+        } else {
+            queueTail->next = &jobs[i];
+        }
+        queueTail = &jobs[i];
+    }
+    pthread_cond_broadcast(&jobQueued);
+    pthread_mutex_unlock(&poolLock);
+
+    runJob(&jobs[0]);
+    pthread_mutex_lock(&poolLock);
+    for (int i = 1; i < count; i++) {
+        while (!jobs[i].done) {
+            // jobs queued by other threads' sorts are done by their turn
+            Job *job = takeJob();
+            if (job == NULL) {
+                pthread_cond_wait(&jobFinished, &poolLock);
+                continue;
+            }
+            pthread_mutex_unlock(&poolLock);
+            runJob(job);
+            pthread_mutex_lock(&poolLock);
+        }
+    }
+    pthread_mutex_unlock(&poolLock);
+
+    // the sublists are in the order they came in, so merging neighbours keeps
+    // the sort stable
+    for (int width = 1; width < count; width *= 2) {
+        for (int i = 0; i + width < count; i += 2 * width) {
+            jobs[i].sorted = merge(jobs[i].sorted, jobs[i + width].sorted, how, NULL);
+        }
+    }
+    return jobs[0].sorted;
+}
+
+// how many threads a sort of length elements compared by how gets
+static int sortThreads(long length, Comparison how) {
+    static int processors;
+    if (how == COMPARE_CALL || length < PARALLEL_SORT_LENGTH) {
+        return 1;
+    }
+    int threads = __atomic_load_n(&processors, __ATOMIC_RELAXED);
+    if (threads == 0) {
+        threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+        __atomic_store_n(&processors, threads, __ATOMIC_RELAXED);
+    }
+    return threads < 1 ? 1 : threads > MAX_SORT_THREADS ? MAX_SORT_THREADS : threads;
+}
+
+Value *sortList(Value *list, Value *less) {
+    // copy the list, noting whether the primitive comparisons can be made
+    // directly
+    Comparison how = COMPARE_CALL;
+    if (less->type == PRIMITIVE_TYPE) {
+        if (!strcmp(less->primitive->name, "<")) {
+            how = COMPARE_LESS;
+        } else if (!strcmp(less->primitive->name, ">")) {
+            how = COMPARE_GREATER;
+        }
+    }
+    Value *copy = NULL;
+    Value **last = &copy;
+    long length = 0;
+    for (; list->type == CONS_TYPE; list = list->c.cdr) {
+        Value *item = list->c.car;
+        if (item->type != INT_TYPE && item->type != DOUBLE_TYPE) {
+            // the primitive reports what it can't compare
+            how = COMPARE_CALL;
+        }
+        *last = cons(item, NULL);
+        last = &(*last)->c.cdr;
+        length++;
+    }
+
+    int threads = sortThreads(length, how);
+    Value *sorted = threads > 1 ? sortParallel(copy, length, threads, how)
+                                : sortRun(copy, how, less);
+    if (sorted == NULL) {
+        return makeNull();
+    }
+    Value *end = sorted;
+    while (end->c.cdr != NULL) {
+        end = end->c.cdr;
+    }
+    end->c.cdr = makeNull();
+    return sorted;
+}
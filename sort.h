@@ -0,0 +1,19 @@
+#include "value.h"
+
+#ifndef _SORT
+#define _SORT
+
+// Sort a copy of list, a proper list, so that for no two adjacent elements
+// (less? later earlier) is true; elements that compare equal stay in the
+// order they came in. The copy is made of fresh cons cells, which a bottom-up
+// merge sort then relinks in place without allocating more, so the list
+// itself is left alone. less? is called through applyArray, except when it is
+// the < or > primitive and every element is a number: then they are compared
+// directly, and lists of at least PARALLEL_SORT_LENGTH elements are split into
+// sublists that a pool of threads, one per extra processor, sorts while the
+// calling thread sorts the first, before the sorted sublists are merged.
+Value *sortList(Value *list, Value *less);
+
+#define PARALLEL_SORT_LENGTH 65536
+
+#endif
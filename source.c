@@ -0,0 +1,112 @@
+#include "source.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+// An open-addressing table from nodes to their positions, which doubles when
+// it is half full.
+typedef struct Entry {
+    Value *node;
+    Position position;
+} Entry;
+
+static int tracking;
+static Entry *entries;
+static size_t capacity;
+static size_t count;
+
+static char **fileNames;
+static int fileCount;
+
+static size_t slotOf(Value *node) {
+    uint64_t hash = ((uintptr_t)node >> 3) * 0x9E3779B97F4A7C15u;
+    return (hash >> 32) & (capacity - 1);
+}
+
+// Start recording the positions of parsed nodes.
+void trackPositions() {
+    tracking = 1;
+}
+
+// Whether positions are being recorded.
+int isTrackingPositions() {
+    return tracking;
+}
+
+// The index positions use for the file called name.
+int sourceFile(char *name) {
+    for (int i = 0; i < fileCount; i++) {
+        if (!strcmp(fileNames[i], name)) {
+            return i;
+        }
+    }
+    fileNames = realloc(fileNames, (fileCount + 1) * sizeof(char *));
+    fileNames[fileCount] = strdup(name);
+    return fileCount++;
+}
+
+// The name of the file with index file.
+char *sourceFileName(int file) {
+    return fileNames[file];
+}
+
+// find node's entry, or the empty one where it would go
+static Entry *lookUp(Value *node) {
+    size_t slot = slotOf(node);
+    while (entries[slot].node != NULL && entries[slot].node != node) {
+        slot = (slot + 1) & (capacity - 1);
+    }
+    return &entries[slot];
+}
+
+static void grow() {
+    Entry *old = entries;
+    size_t oldCapacity = capacity;
+    capacity = capacity == 0 ? 4096 : capacity * 2;
+    entries = calloc(capacity, sizeof(Entry));
+    for (size_t i = 0; i < oldCapacity; i++) {
+        if (old[i].node != NULL) {
+            *lookUp(old[i].node) = old[i];
+        }
+    }
+    free(old);
+}
+
+// Record that node starts at line and column of file.
+void setPosition(Value *node, int file, int line, int column) {
+    if (!tracking) {
+        return;
+    }
+    if (2 * (count + 1) > capacity) {
+        grow();
+    }
+    Entry *entry = lookUp(node);
+    if (entry->node == NULL) {
+        count++;
+    }
+    entry->node = node;
+    entry->position.line = line;
+    entry->position.column = column;
+    entry->position.file = file;
+}
+
+// Give to the node the position of from, if it has one.
+void copyPosition(Value *from, Value *to) {
+    Position position;
+    if (findPosition(from, &position)) {
+        setPosition(to, position.file, position.line, position.column);
+    }
+}
+
+// Look up where node starts. Returns 0 if it has no recorded position.
+int findPosition(Value *node, Position *position) {
+    if (count == 0) {
+        return 0;
+    }
+    Entry *entry = lookUp(node);
+    if (entry->node == NULL) {
+        return 0;
+    }
+    *position = entry->position;
+    return 1;
+}
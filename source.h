@@ -0,0 +1,37 @@
+#include "value.h"
+
+#ifndef _SOURCE
+#define _SOURCE
+
+// Where in the source a parsed node came from. Positions are kept in a side
+// table keyed by the node rather than in the values themselves, and only
+// while they are being tracked, so parsing normally pays nothing for them.
+typedef struct Position {
+    unsigned int line;
+    unsigned short column;
+    // index of the file's name, see sourceFileName
+    unsigned short file;
+} Position;
+
+// Start recording the positions of parsed nodes.
+void trackPositions();
+
+// Whether positions are being recorded.
+int isTrackingPositions();
+
+// The index positions use for the file called name.
+int sourceFile(char *name);
+
+// The name of the file with index file.
+char *sourceFileName(int file);
+
+// Record that node starts at line and column of file.
+void setPosition(Value *node, int file, int line, int column);
+
+// Give to the node the position of from, if it has one.
+void copyPosition(Value *from, Value *to);
+
+// Look up where node starts. Returns 0 if it has no recorded position.
+int findPosition(Value *node, Position *position);
+
+#endif
@@ -1,6 +1,161 @@
 #include "talloc.h"
+#include "output.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
 
-Value *active;
+// Memory is handed out from large chunks, each aligned on its own size so the
+// chunk (and region) owning any talloc'd pointer can be found by masking.
+#define CHUNK_SIZE 65536
+#define ALIGNMENT 8
+
+typedef struct Chunk {
+    struct Chunk *next;
+    struct Region *region;
+    char *top;
+    char *end;
+} Chunk;
+
+struct Region {
+    Chunk *chunks;
+    struct Region *next;
+};
+
+// Each thread allocates from its own current region, and only has to take
+// the lock when it needs a new chunk. Looking chunks up takes it for reading,
+// once other threads may be adding chunks at the same time.
+static Region defaultRegion;
+static __thread Region *current = &defaultRegion;
+static pthread_rwlock_t chunkLock = PTHREAD_RWLOCK_INITIALIZER;
+static int shared;
+
+// bytes of chunks held, and how many may be before talloc fails
+static size_t allocated;
+static size_t allocationLimit = SIZE_MAX;
+
+// told about every allocation, if set
+static void (*allocationHook)(size_t size, MemoryKind kind);
+static __thread jmp_buf *recoveryPoint;
+
+// Every chunk, in an open-addressing table, so that inRegion can tell in
+// constant time whether an arbitrary pointer is in one of them.
+static Chunk **chunkTable;
+static size_t tableCapacity;
+static size_t tableCount;
+
+static size_t chunkSlot(Chunk *chunk) {
+    uint64_t hash = ((uintptr_t)chunk / CHUNK_SIZE) * 0x9E3779B97F4A7C15u;
+    return (hash >> 32) & (tableCapacity - 1);
+}
+
+static void insertChunk(Chunk *chunk) {
+    if ((tableCount + 1) * 2 > tableCapacity) {
+        Chunk **old = chunkTable;
+        size_t oldCapacity = tableCapacity;
+        tableCapacity = oldCapacity ? oldCapacity * 2 : 1024;
+        chunkTable = calloc(tableCapacity, sizeof(Chunk *));
+        for (size_t i = 0; i < oldCapacity; i++) {
+            if (old[i] != NULL) {
+                size_t slot = chunkSlot(old[i]);
+                while (chunkTable[slot] != NULL) {
+                    slot = (slot + 1) & (tableCapacity - 1);
+                }
+                chunkTable[slot] = old[i];
+            }
+        }
+        free(old);
+    }
+    size_t slot = chunkSlot(chunk);
+    while (chunkTable[slot] != NULL) {
+        slot = (slot + 1) & (tableCapacity - 1);
+    }
+    chunkTable[slot] = chunk;
+    tableCount++;
+}
+
+// the chunk that owns pointer, or NULL if talloc didn't hand it out
+static Chunk *findChunk(void *pointer) {
+    if (tableCapacity == 0) {
+        return NULL;
+    }
+    Chunk *owner = (Chunk *)((uintptr_t)pointer & ~(uintptr_t)(CHUNK_SIZE - 1));
+    for (size_t slot = chunkSlot(owner); chunkTable[slot] != NULL;
+         slot = (slot + 1) & (tableCapacity - 1)) {
+        if (chunkTable[slot] == owner) {
+            return owner;
+        }
+    }
+    return NULL;
+}
+
+// Let threads that allocate while others look chunks up share the heap: from
+// now on lookups take the lock too.
+void shareHeap() {
+    pthread_rwlock_wrlock(&chunkLock);
+    shared = 1;
+    pthread_rwlock_unlock(&chunkLock);
+}
+
+// take chunk out of the table and free it
+static void freeChunk(Chunk *chunk) {
+    pthread_rwlock_wrlock(&chunkLock);
+    size_t slot = chunkSlot(chunk);
+    while (chunkTable[slot] != chunk) {
+        slot = (slot + 1) & (tableCapacity - 1);
+    }
+    // shift later entries of the same probe sequence back into the hole
+    size_t hole = slot;
+    for (size_t next = (hole + 1) & (tableCapacity - 1); chunkTable[next] != NULL;
+         next = (next + 1) & (tableCapacity - 1)) {
+        size_t home = chunkSlot(chunkTable[next]);
+        if (((next - home) & (tableCapacity - 1)) >= ((next - hole) & (tableCapacity - 1))) {
+            chunkTable[hole] = chunkTable[next];
+            hole = next;
+        }
+    }
+    chunkTable[hole] = NULL;
+    tableCount--;
+    allocated -= chunk->end - (char *)chunk;
+    pthread_rwlock_unlock(&chunkLock);
+    free(chunk);
+}
+
+// get a fresh chunk big enough for size bytes and link it into region
+static Chunk *newChunk(Region *region, size_t size) {
+    size_t total = sizeof(Chunk) + size;
+    total = (total + CHUNK_SIZE - 1) / CHUNK_SIZE * CHUNK_SIZE;
+
+    pthread_rwlock_wrlock(&chunkLock);
+    int overLimit = allocated + total > allocationLimit;
+    Chunk *chunk = overLimit ? NULL : aligned_alloc(CHUNK_SIZE, total);
+    if (chunk != NULL) {
+        insertChunk(chunk);
+        allocated += total;
+    }
+    pthread_rwlock_unlock(&chunkLock);
+    if (overLimit) {
+        allocationLimit = SIZE_MAX;
+        printf("Evaluation error: memory limit exceeded.\n");
+        texit(1);
+    }
+    if (chunk == NULL) {
+        printf("Evaluation error: out of memory.\n");
+        texit(1);
+    }
+    chunk->region = region;
+    chunk->top = (char *)chunk + sizeof(Chunk);
+    chunk->end = (char *)chunk + total;
+
+    // an oversized chunk is full at once, so keep the current chunk in front
+    if (total > CHUNK_SIZE && region->chunks != NULL) {
+        chunk->next = region->chunks->next;
+        region->chunks->next = chunk;
+    } else {
+        chunk->next = region->chunks;
+        region->chunks = chunk;
+    }
+    return chunk;
+}
 
 // Replacement for malloc that stores the pointers allocated. It should store
 // the pointers in some kind of list; a linked list would do fine, but insert
@@ -8,44 +163,197 @@ Value *active;
 // pre-existing linkedlist.h. Otherwise you'll end up with circular
 // dependencies, since you're going to modify the linked list to use talloc.
 void *talloc(size_t size) {
+    return tallocKind(size, OTHER_MEMORY);
+}
 
-    void *pointer = malloc(size); // malloc space
-    
-    // set up current node, which is a cons
-    Value *curr = malloc(sizeof(Value));
-    curr->type = CONS_TYPE;
-    
-    // set up car of the cons and store the malloced pointer
-    curr->c.car = malloc(sizeof(Value));
-    curr->c.car->type = PTR_TYPE;
-    curr->c.car->p = pointer;
-
-    // set up cdr of the cons pointing to head
-    curr->c.cdr = active;
-    
-    // update head
-    active = curr;
+// talloc for memory of the given kind.
+void *tallocKind(size_t size, MemoryKind kind) {
+    size = (size + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1);
+    if (allocationHook != NULL) {
+        allocationHook(size, kind);
+    }
+
+    Chunk *chunk = current->chunks;
+    if (chunk == NULL || (size_t)(chunk->end - chunk->top) < size) {
+        chunk = newChunk(current, size);
+    }
+
+    void *pointer = chunk->top;
+    chunk->top += size;
     return pointer;
 };
-    
+
+
+// Create a new, empty region. It is freed by tfree along with everything else.
+Region *newRegion() {
+    Region *region = malloc(sizeof(Region));
+    region->chunks = NULL;
+    pthread_rwlock_wrlock(&chunkLock);
+    region->next = defaultRegion.next;
+    defaultRegion.next = region;
+    pthread_rwlock_unlock(&chunkLock);
+    return region;
+}
+
+// Free region and everything allocated in it, before tfree would.
+void freeRegion(Region *region) {
+    clearRegion(region);
+    if (region->chunks != NULL) {
+        freeChunk(region->chunks);
+    }
+    pthread_rwlock_wrlock(&chunkLock);
+    for (Region *r = &defaultRegion; r->next != NULL; r = r->next) {
+        if (r->next == region) {
+            r->next = region->next;
+            break;
+        }
+    }
+    pthread_rwlock_unlock(&chunkLock);
+    free(region);
+}
+
+// Make region the one talloc allocates from, and return the region that was
+// current before.
+Region *useRegion(Region *region) {
+    Region *previous = current;
+    current = region;
+    return previous;
+}
+
+// Free everything allocated in region. The region stays usable afterwards, and
+// keeps one ordinary chunk around so that reusing it doesn't go back to malloc.
+void clearRegion(Region *region) {
+    Chunk *kept = NULL;
+    Chunk *chunk = region->chunks;
+    while (chunk != NULL) {
+        Chunk *next = chunk->next;
+        if (kept == NULL && chunk->end - (char *)chunk == CHUNK_SIZE) {
+            kept = chunk;
+            kept->top = (char *)kept + sizeof(Chunk);
+            kept->next = NULL;
+        } else {
+            freeChunk(chunk);
+        }
+        chunk = next;
+    }
+    region->chunks = kept;
+}
+
+// Move everything allocated in from over to into, leaving from empty.
+void mergeRegion(Region *from, Region *into) {
+    if (from->chunks == NULL) {
+        return;
+    }
+    Chunk *last = from->chunks;
+    for (;;) {
+        last->region = into;
+        if (last->next == NULL) {
+            break;
+        }
+        last = last->next;
+    }
+    // into's current chunk stays in front, to carry on allocating from
+    if (into->chunks != NULL) {
+        last->next = into->chunks->next;
+        into->chunks->next = from->chunks;
+    } else {
+        into->chunks = from->chunks;
+    }
+    from->chunks = NULL;
+}
+
+// Check whether pointer was returned by talloc while region was current.
+int inRegion(void *pointer, Region *region) {
+    if (!shared) {
+        Chunk *owner = findChunk(pointer);
+        return owner != NULL && owner->region == region;
+    }
+    pthread_rwlock_rdlock(&chunkLock);
+    Chunk *owner = findChunk(pointer);
+    pthread_rwlock_unlock(&chunkLock);
+    return owner != NULL && owner->region == region;
+}
+
+Region *regionOf(void *pointer) {
+    if (!shared) {
+        Chunk *owner = findChunk(pointer);
+        return owner != NULL ? owner->region : NULL;
+    }
+    pthread_rwlock_rdlock(&chunkLock);
+    Chunk *owner = findChunk(pointer);
+    pthread_rwlock_unlock(&chunkLock);
+    return owner != NULL ? owner->region : NULL;
+}
 
 // Free all pointers allocated by talloc, as well as whatever memory you
 // allocated in lists to hold those pointers.
 void tfree() {
-    while (active != NULL) {
-        Value *temp = active;
-        active = active->c.cdr;
-        free(temp->c.car->p);
-        free(temp->c.car);
-        free(temp);
+    clearRegion(&defaultRegion);
+    if (defaultRegion.chunks != NULL) {
+        freeChunk(defaultRegion.chunks);
     }
+    defaultRegion.chunks = NULL;
+
+    while (defaultRegion.next != NULL) {
+        Region *region = defaultRegion.next;
+        defaultRegion.next = region->next;
+        clearRegion(region);
+        if (region->chunks != NULL) {
+            freeChunk(region->chunks);
+        }
+        free(region);
+    }
+    current = &defaultRegion;
 };
 
 
+// Number of bytes talloc holds in chunks, whether handed out yet or not.
+size_t allocatedBytes() {
+    pthread_rwlock_rdlock(&chunkLock);
+    size_t bytes = allocated;
+    pthread_rwlock_unlock(&chunkLock);
+    return bytes;
+}
+
+// Make talloc end evaluation with an error rather than hold more than limit
+// bytes; SIZE_MAX lifts the limit.
+void limitAllocation(size_t limit) {
+    allocationLimit = limit;
+}
+
+// Whether there is a limit on the bytes talloc holds.
+int isAllocationLimited() {
+    return allocationLimit != SIZE_MAX;
+}
+
+// Have hook called with the size and kind of every allocation from now on.
+void setAllocationHook(void (*hook)(size_t size, MemoryKind kind)) {
+    allocationHook = hook;
+}
+
+// Install a recovery point for texit. While one is set, texit jumps back to it
+// (with a nonzero status) instead of ending the program. NULL removes it.
+// Returns the one installed before.
+jmp_buf *setRecovery(jmp_buf *recovery) {
+    jmp_buf *previous = recoveryPoint;
+    recoveryPoint = recovery;
+    return previous;
+}
+
 // Replacement for the C function "exit", that consists of two lines: it calls
 // tfree before calling exit. It's useful to have later on; if an error happens,
 // you can exit your program, and all memory is automatically cleaned up.
 void texit(int status){
-    tfree();
+    // the error's message went to stdio after output still in the program's
+    // buffer; write both out now, in that order, since the program may go on
+    flushOutput();
+    fflush(stdout);
+    if (recoveryPoint != NULL) {
+        longjmp(*recoveryPoint, status != 0 ? status : 1);
+    }
+    // other threads may still be using their memory; exiting frees it anyway
+    if (!shared) {
+        tfree();
+    }
     exit(status);
 }
@@ -1,9 +1,18 @@
 #include <stdlib.h>
+#include <setjmp.h>
 #include "value.h"
 
 #ifndef _TALLOC
 #define _TALLOC
 
+// A region is a group of allocations that are released together. talloc
+// always carves memory out of the current region; the program starts out in a
+// default region that lives until tfree. Each thread has a current region of
+// its own (the default one to begin with), and threads may allocate at the
+// same time as long as they use different regions. A region is cleared or
+// freed by the thread that allocates from it.
+typedef struct Region Region;
+
 // Replacement for malloc that stores the pointers allocated. It should store
 // the pointers in some kind of list; a linked list would do fine, but insert
 // here whatever code you'll need to do so; don't call functions in the
@@ -11,6 +20,18 @@
 // dependencies, since you're going to modify the linked list to use talloc.
 void *talloc(size_t size);
 
+// What memory is for, as far as the heap profiler is concerned.
+typedef enum {
+    OTHER_MEMORY, FRAME_MEMORY, CONS_MEMORY, NUMBER_MEMORY, CLOSURE_MEMORY
+} MemoryKind;
+
+// talloc for memory of the given kind.
+void *tallocKind(size_t size, MemoryKind kind);
+
+// Have hook called with the size and kind of every allocation from now on;
+// NULL stops it.
+void setAllocationHook(void (*hook)(size_t size, MemoryKind kind));
+
 // Free all pointers allocated by talloc, as well as whatever memory you
 // allocated in lists to hold those pointers.
 void tfree();
@@ -20,5 +41,51 @@ void tfree();
 // you can exit your program, and all memory is automatically cleaned up.
 void texit(int status);
 
-#endif
+// Create a new, empty region. It is freed by tfree along with everything else.
+Region *newRegion();
+
+// Make region the one talloc allocates from, and return the region that was
+// current before.
+Region *useRegion(Region *region);
+
+// Free everything allocated in region. The region stays usable afterwards.
+void clearRegion(Region *region);
+
+// Free region and everything allocated in it, before tfree would.
+void freeRegion(Region *region);
+
+// Move everything allocated in from over to into, leaving from empty.
+void mergeRegion(Region *from, Region *into);
 
+// Check whether pointer was returned by talloc while region was current.
+int inRegion(void *pointer, Region *region);
+
+// The region that was current when talloc returned pointer, or NULL if talloc
+// didn't hand it out.
+Region *regionOf(void *pointer);
+
+// Allow threads to allocate while other threads ask inRegion, for good: from
+// then on inRegion takes a lock, and texit leaves the memory to the operating
+// system instead of freeing it under other threads. Called before starting
+// threads that outlive the call that started them.
+void shareHeap();
+
+// Number of bytes talloc holds in chunks, whether handed out yet or not.
+size_t allocatedBytes();
+
+// Make talloc end evaluation with an error rather than hold more than limit
+// bytes (checked each time it needs a new chunk, so freed regions make room
+// again); SIZE_MAX lifts the limit.
+void limitAllocation(size_t limit);
+
+// Whether there is a limit on the bytes talloc holds.
+int isAllocationLimited();
+
+// Install a recovery point for texit, in the calling thread. While one is set,
+// texit jumps back to it (with a nonzero status) instead of ending the
+// program. Either way texit first writes out the thread's buffered output
+// and then stdout, so the error's message comes after what was printed
+// before it. NULL removes it. Returns the one installed before.
+jmp_buf *setRecovery(jmp_buf *recovery);
+
+#endif
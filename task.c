@@ -0,0 +1,362 @@
+#include "task.h"
+#include "interpreter.h"
+#include "talloc.h"
+#include "output.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <setjmp.h>
+#include <ucontext.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+
+// The stack of each task, as deep as an actor's since loops are recursions;
+// only the pages used are ever backed by memory. The inaccessible page below
+// it turns running off its end into a crash rather than a scribble.
+#define TASK_STACK_SIZE ((size_t)256 << 20)
+#define GUARD_SIZE 4096
+// stacks of finished tasks kept for new ones
+#define SPARE_STACKS 16
+#define MAX_EVENTS 64
+
+typedef struct Task {
+    ucontext_t context;
+    char *stack;
+    Value *thunk;
+    // the recovery point texit jumps to while the task runs
+    jmp_buf *recovery;
+    // when a sleeping task is due
+    double wakeAt;
+    // next in the run queue
+    struct Task *next;
+} Task;
+
+// The scheduler of each thread: the program itself, the task running, the
+// runnable ones in the order they get their turn, sleepers in a heap ordered
+// by when they are due and the count of tasks waiting in epoll.
+static __thread Task programTask;
+static __thread Task *running;
+static __thread Task *runHead;
+static __thread Task *runTail;
+static __thread Task **sleepers;
+static __thread size_t sleeperCount;
+static __thread size_t sleeperCapacity;
+static __thread int waiting;
+static __thread int epollFd = -1;
+
+// spawned tasks that haven't returned yet
+static __thread long live;
+// whether the program waits for them in waitForTasks
+static __thread int joining;
+
+// a task that has returned, freed by the next one to run since it can't free
+// the stack it is still on
+static __thread Task *finished;
+static __thread char *spareStacks[SPARE_STACKS];
+static __thread int spareCount;
+
+static double now() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+static Task *currentTask() {
+    if (running == NULL) {
+        running = &programTask;
+    }
+    return running;
+}
+
+static char *newStack() {
+    if (spareCount > 0) {
+        return spareStacks[--spareCount];
+    }
+    char *stack = mmap(NULL, TASK_STACK_SIZE + GUARD_SIZE, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+    if (stack == MAP_FAILED) {
+        return NULL;
+    }
+    mprotect(stack, GUARD_SIZE, PROT_NONE);
+    return stack;
+}
+
+static void releaseFinished() {
+    if (finished == NULL) {
+        return;
+    }
+    if (spareCount < SPARE_STACKS) {
+        // the pages a deep recursion touched go back to the system
+        madvise(finished->stack + GUARD_SIZE, TASK_STACK_SIZE, MADV_DONTNEED);
+        spareStacks[spareCount++] = finished->stack;
+    } else {
+        munmap(finished->stack, TASK_STACK_SIZE + GUARD_SIZE);
+    }
+    free(finished);
+    finished = NULL;
+}
+
+static void makeRunnable(Task *task) {
+    task->next = NULL;
+    if (runTail == NULL) {
+        runHead = task;
+    } else {
+        runTail->next = task;
+    }
+    runTail = task;
+}
+
+// SLEEPERS
+
+static void addSleeper(Task *task) {
+    if (sleeperCount == sleeperCapacity) {
+        sleeperCapacity = sleeperCapacity ? sleeperCapacity * 2 : 64;
+        sleepers = realloc(sleepers, sleeperCapacity * sizeof(Task *));
+    }
+    size_t i = sleeperCount++;
+    while (i > 0 && sleepers[(i - 1) / 2]->wakeAt > task->wakeAt) {
+        sleepers[i] = sleepers[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    sleepers[i] = task;
+}
+
+static Task *removeEarliestSleeper() {
+    Task *earliest = sleepers[0];
+    Task *last = sleepers[--sleeperCount];
+    size_t i = 0;
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= sleeperCount) {
+            break;
+        }
+        if (child + 1 < sleeperCount && sleepers[child + 1]->wakeAt < sleepers[child]->wakeAt) {
+            child++;
+        }
+        if (last->wakeAt <= sleepers[child]->wakeAt) {
+            break;
+        }
+        sleepers[i] = sleepers[child];
+        i = child;
+    }
+    if (sleeperCount > 0) {
+        sleepers[i] = last;
+    }
+    return earliest;
+}
+
+// SWITCHING
+
+// The next task to run, waiting for a sleeper to be due or a port to be ready
+// if none is runnable yet. NULL if nothing could ever become runnable.
+static Task *nextTask() {
+    for (;;) {
+        if (sleeperCount > 0) {
+            double time = now();
+            while (sleeperCount > 0 && sleepers[0]->wakeAt <= time) {
+                makeRunnable(removeEarliestSleeper());
+            }
+        }
+        if (runHead == NULL) {
+            // what was printed so far goes out before waiting
+            flushOutput();
+        }
+        if (waiting > 0) {
+            int timeout = -1;
+            if (runHead != NULL) {
+                timeout = 0;
+            } else if (sleeperCount > 0) {
+                // rounded up, so as not to wake just before it is due
+                double left = sleepers[0]->wakeAt - now();
+                timeout = left > 0 ? (int)(left * 1000) + 1 : 0;
+            }
+            struct epoll_event events[MAX_EVENTS];
+            int count = epoll_wait(epollFd, events, MAX_EVENTS, timeout);
+            for (int i = 0; i < count; i++) {
+                makeRunnable(events[i].data.ptr);
+            }
+        } else if (runHead == NULL && sleeperCount > 0) {
+            double left = sleepers[0]->wakeAt - now();
+            if (left > 0) {
+                struct timespec pause = {(time_t)left, (long)((left - (time_t)left) * 1e9)};
+                nanosleep(&pause, NULL);
+            }
+            continue;
+        }
+        if (runHead != NULL) {
+            Task *task = runHead;
+            runHead = task->next;
+            if (runHead == NULL) {
+                runTail = NULL;
+            }
+            return task;
+        }
+        if (waiting == 0 && sleeperCount == 0) {
+            return NULL;
+        }
+    }
+}
+
+// Give the thread to the next task; returns once the calling task, which must
+// have been queued, put to sleep or left waiting, is run again.
+static void switchAway() {
+    Task *from = currentTask();
+    Task *to = nextTask();
+    if (to == NULL) {
+        printf("Evaluation error: every task is waiting for another.\n");
+        texit(1);
+    }
+    if (to == from) {
+        return;
+    }
+    from->recovery = setRecovery(to->recovery);
+    running = to;
+    swapcontext(&from->context, &to->context);
+    releaseFinished();
+}
+
+// where every task starts, on its own stack
+static void runTask() {
+    releaseFinished();
+    Task *task = running;
+    jmp_buf recovery;
+    if (setjmp(recovery) == 0) {
+        setRecovery(&recovery);
+        applyArray(task->thunk, 0, NULL);
+    }
+    setRecovery(NULL);
+
+    live--;
+    if (live == 0 && joining) {
+        joining = 0;
+        makeRunnable(&programTask);
+    }
+    finished = task;
+    Task *to = nextTask();
+    if (to == NULL) {
+        printf("Evaluation error: every task is waiting for another.\n");
+        texit(1);
+    }
+    running = to;
+    setRecovery(to->recovery);
+    setcontext(&to->context);
+}
+
+// TASKS
+
+// Start a task that calls thunk.
+int spawnTask(Value *thunk) {
+    currentTask();
+    Task *task = calloc(1, sizeof(Task));
+    task->stack = newStack();
+    if (task->stack == NULL) {
+        free(task);
+        return 1;
+    }
+    getcontext(&task->context);
+    task->context.uc_stack.ss_sp = task->stack + GUARD_SIZE;
+    task->context.uc_stack.ss_size = TASK_STACK_SIZE;
+    task->context.uc_link = NULL;
+    makecontext(&task->context, runTask, 0);
+    task->thunk = thunk;
+    live++;
+    makeRunnable(task);
+    return 0;
+}
+
+// Let the other runnable tasks have a turn.
+void yieldTask() {
+    if (live == 0 || (runHead == NULL && waiting == 0 && sleeperCount == 0)) {
+        return;
+    }
+    makeRunnable(currentTask());
+    switchAway();
+}
+
+// Let other tasks run for at least seconds.
+void sleepTask(double seconds) {
+    if (live == 0) {
+        if (seconds > 0) {
+            struct timespec pause = {(time_t)seconds, (long)((seconds - (time_t)seconds) * 1e9)};
+            while (nanosleep(&pause, &pause) != 0 && errno == EINTR) {
+            }
+        }
+        return;
+    }
+    Task *task = currentTask();
+    task->wakeAt = now() + seconds;
+    addSleeper(task);
+    switchAway();
+}
+
+// Whether other tasks could run while the calling one waits.
+int hasOtherTasks() {
+    return live > 0;
+}
+
+// Let other tasks run until fd is ready.
+void waitForFd(int fd, int writing) {
+    if (live == 0) {
+        return;
+    }
+    struct pollfd ready = {fd, writing ? POLLOUT : POLLIN, 0};
+    if (poll(&ready, 1, 0) != 0) {
+        return;
+    }
+    if (epollFd < 0) {
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+    }
+    struct epoll_event event;
+    event.events = (writing ? EPOLLOUT : EPOLLIN) | EPOLLONESHOT;
+    event.data.ptr = currentTask();
+    // another task may be waiting on fd already, and a file can only be in
+    // epoll once under each descriptor
+    int watched = fd;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, watched, &event) != 0) {
+        watched = errno == EEXIST ? dup(fd) : -1;
+        if (watched < 0 || epoll_ctl(epollFd, EPOLL_CTL_ADD, watched, &event) != 0) {
+            // not something epoll can watch, such as a regular file
+            if (watched >= 0) {
+                close(watched);
+            }
+            return;
+        }
+    }
+    waiting++;
+    switchAway();
+    waiting--;
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, watched, NULL);
+    if (watched != fd) {
+        close(watched);
+    }
+}
+
+// Run body on a stack of its own as deep as a task's, returning once it has
+// returned; if no stack can be mapped it runs on the caller's instead.
+void runOnTaskStack(void (*body)()) {
+    char *stack = newStack();
+    if (stack == NULL) {
+        body();
+        return;
+    }
+    ucontext_t caller;
+    ucontext_t context;
+    getcontext(&context);
+    context.uc_stack.ss_sp = stack + GUARD_SIZE;
+    context.uc_stack.ss_size = TASK_STACK_SIZE;
+    context.uc_link = &caller;
+    makecontext(&context, body, 0);
+    swapcontext(&caller, &context);
+    munmap(stack, TASK_STACK_SIZE + GUARD_SIZE);
+}
+
+// Let the tasks spawned so far run until all of them have returned.
+void waitForTasks() {
+    if (live > 0) {
+        joining = 1;
+        switchAway();
+    }
+}
@@ -0,0 +1,43 @@
+#include "value.h"
+
+#ifndef _TASK
+#define _TASK
+
+// Tasks are cooperative threads that take turns on the thread that spawned
+// them, for scripts that mostly wait on pipes, terminals and timers. Each task
+// runs on a stack of its own, mapped without reserving memory so that only
+// the pages it touches count; the program itself is a task too, on the
+// thread's own stack or one set up by runOnTaskStack. A task runs until it
+// yields, sleeps, waits on a port or returns; then the next runnable task
+// takes over, and when none is runnable the thread waits in epoll for a port
+// to become ready or a sleeper to be due.
+// Tasks share the heap and the global frame.
+
+// Start a task that calls thunk, a closure of no parameters. It first runs
+// when the calling task next gives up its turn. An error in the task ends it
+// alone, after printing its message. Returns 0 on success.
+int spawnTask(Value *thunk);
+
+// Let the other runnable tasks have a turn.
+void yieldTask();
+
+// Let other tasks run for at least seconds.
+void sleepTask(double seconds);
+
+// Whether other tasks could run while the calling one waits.
+int hasOtherTasks();
+
+// Let other tasks run until fd is ready for reading (or, if writing, for
+// writing), if there are any; otherwise return at once.
+void waitForFd(int fd, int writing);
+
+// Let the tasks spawned so far run until all of them have returned.
+void waitForTasks();
+
+// Run body on a stack of its own, mapped like a task's, and return once it
+// has returned. The interpreter has no tail calls, so every loop is a
+// recursion, and the program runs this way to get as deep as tasks and
+// actors do rather than as deep as the thread's stack allows.
+void runOnTaskStack(void (*body)());
+
+#endif
@@ -0,0 +1,32 @@
+(define log (quote ()))
+(define note (lambda (item) (set! log (cons item log))))
+(define worker
+  (lambda (name n)
+    (lambda ()
+      (if (= n 0)
+          (note (cons name (quote done)))
+          (begin (note (cons name n)) (yield) ((worker name (- n 1))))))))
+(spawn (worker (quote a) 3))
+(spawn (worker (quote b) 2))
+log
+(yield)
+(reverse log)
+(sleep 0.01)
+(reverse log)
+(set! log (quote ()))
+(spawn (lambda () (begin (sleep 0.06) (note (quote slow)) (spawn (lambda () (note (quote child)))))))
+(spawn (lambda () (begin (sleep 0.02) (note (quote fast)))))
+(spawn (lambda () (note (quote now))))
+(sleep 0.1)
+(yield)
+(reverse log)
+(spawn (lambda () (car (quote ()))))
+(spawn (lambda () (note (quote after-error))))
+(sleep 0)
+(car log)
+(+ 1 0)
+(spawn (lambda () (car 5)))
+(yield)
+(+ 2 0)
+(+ 3 0)
+(sleep (quote soon))
@@ -0,0 +1,28 @@
+(define never (lambda (1 x x) (car (quote ()))))
+(define twice (lambda (x) (double (double x))))
+(define-syntax double
+  (syntax-rules ()
+    ((_ e) (* 2 e))))
+(twice 5)
+(twice 1.5)
+(define adder (lambda (n) (lambda (x) (double (+ x n)))))
+((adder 1) 2)
+((adder 10) 2)
+(define-syntax my-if (syntax-rules () ((_ c a b) (cond (c a) (else b)))))
+(define f (lambda (x) (my-if x (quote yes) (quote no))))
+(f #t)
+(map (lambda (x) (* x x)) (quote (1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18 19 20)))
+(f #f)
+(define make (lambda (n) (lambda (x) (my-if (< x n) (quote below) (quote above)))))
+(define below5 (make 5))
+(below5 3)
+(map (lambda (x) (cons x x)) (quote (1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18 19 20)))
+(below5 7)
+((make 1) 0)
+(define later (make 2))
+(map (lambda (x) (+ x 1)) (quote (1 2 3 4 5 6 7 8 9 10)))
+(later 1)
+(f #t)
+(define swap (lambda (a b) (cons b a)))
+(swap 1 2)
+(swap 1)
@@ -0,0 +1,15 @@
+(define data (quote (5 3 8 1 9 2 7 3.5 0 -4)))
+(sort data <)
+(sort data >)
+data
+(sort (quote ()) <)
+(sort (quote (1)) <)
+(define pairs (quote ((b 2) (a 1) (c 2) (d 1) (e 0))))
+(sort pairs (lambda (x y) (< (car (cdr x)) (car (cdr y)))))
+(sort (quote (3 1 2)) (lambda (x y) (> x y)))
+(define build (lambda (n acc) (if (= n 0) acc (build (- n 1) (cons (modulo (* n 7919) 100003) acc)))))
+(define big (sort (build 2000 (quote ())) <))
+(define sorted? (lambda (l) (if (null? (cdr l)) #t (if (> (car l) (car (cdr l))) #f (sorted? (cdr l))))))
+(sorted? big)
+(length big)
+(sort (quote (2 a 1)) <)
@@ -0,0 +1,4 @@
+(define build (lambda (i acc) (if (= i 20000) acc (build (+ i 1) (cons i acc)))))
+(car (build 0 (quote ())))
+(define count (lambda (n) (if (= n 0) 0 (+ 1 (count (- n 1))))))
+(count 20000)
@@ -0,0 +1,26 @@
+(define fib
+  (lambda (n)
+    (if (< n 2)
+        n
+        (+ (fib (- n 1)) (fib (- n 2))))))
+(fib 20)
+(fib 5.0)
+(define count
+  (lambda (n acc)
+    (if (= n 0) acc (count (- n 1) (* acc 1)))))
+(count 200 7)
+(define sq (lambda (x) (* x x)))
+(define hammer (lambda (n) (if (= n 0) (sq 7) (begin (sq n) (hammer (- n 1))))))
+(hammer 200)
+(define * (lambda (a b) 0))
+(sq 5)
+(set! * (lambda (a b) 1))
+(sq 5)
+(define keep +)
+(define add (lambda (a b) (keep a b)))
+(define hammer2 (lambda (n) (if (= n 0) (add 2 3) (begin (add n n) (hammer2 (- n 1))))))
+(hammer2 200)
+(set! keep -)
+(add 2 3)
+(define + -)
+(fib 20)
@@ -0,0 +1,22 @@
+(define integers-from
+  (lambda (n)
+    (cons-stream n (integers-from (+ n 1)))))
+
+(define naturals (integers-from 0))
+(stream-car naturals)
+(stream-car (stream-cdr (stream-cdr naturals)))
+(stream-take naturals 5)
+
+(define evens (stream-filter (lambda (x) (= (modulo x 2) 0)) naturals))
+(stream-take (stream-map (lambda (x) (* x x)) evens) 5)
+(stream-take (stream-map + naturals (stream-cdr naturals)) 4)
+(stream-car (stream-filter (lambda (x) (> x 5000)) naturals))
+
+(define count 0)
+(define p (delay (begin (set! count (+ count 1)) count)))
+(force p)
+(force p)
+count
+(force (make-promise 7))
+(force 3)
+(stream-take (cons-stream 1 (quote ())) 10)
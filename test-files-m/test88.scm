@@ -0,0 +1,19 @@
+(define nums (quote (3 1 4 1 5 9 2 6)))
+(length nums)
+(length (quote ()))
+(reverse nums)
+(append (quote (1 2)) (quote ()) (quote (3 4)) (quote (5)))
+(append)
+(list-ref nums 5)
+(map (lambda (x) (* x 10)) nums)
+(map + (quote (1 2 3)) (quote (10 20)))
+(filter (lambda (x) (> x 3)) nums)
+(fold + 0 nums)
+(fold cons (quote ()) (quote (1 2 3)))
+(for-each (lambda (x) x) nums)
+(member 5 nums)
+(member 7 nums)
+(assoc (quote b) (quote ((a 1) (b 2) (c 3))))
+(assoc "y" (quote (("x" 1) ("y" 2))))
+(member (quote (1 2)) (quote ((1) (1 2) (3))))
+(list-ref nums 8)
@@ -0,0 +1,19 @@
+(define a (f64vector 1 2.5 -3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18))
+(define b (make-f64vector 18 2))
+a
+(f64vector-length a)
+(f64vector-ref a 1)
+(f64vector-sum a)
+(f64vector-dot a b)
+(f64vector-min a)
+(f64vector-max a)
+(f64vector-add (f64vector 1 2 3) (f64vector 10 20 30))
+(f64vector-mul (f64vector 1 2 3) (f64vector 10 20 30))
+(f64vector-scale (f64vector 1 2 3) 0.5)
+(f64vector-set! b 0 -7)
+(f64vector->list (list->f64vector (quote (1 2 3))))
+(f64vector-min b)
+(f64vector? b)
+(f64vector? (quote (1 2)))
+(make-f64vector 0)
+(f64vector-ref a 18)
@@ -0,0 +1,21 @@
+(define out (open-output-file "/tmp/scheme-port-test.txt"))
+(write-string "first line" out)
+(newline out)
+(write-string "(define x 42) (+ 1 2)" out)
+(newline out)
+(write-string "last" out)
+(close-port out)
+
+(define in (open-input-file "/tmp/scheme-port-test.txt"))
+(read-line in)
+(peek-char in)
+(read-char (open-input-file "/tmp/scheme-port-test.txt"))
+(read in)
+(read in)
+(read-line in)
+(read-line in)
+(eof-object? (read-line in))
+(close-port in)
+(write-string "done")
+(newline)
+(read-line in)
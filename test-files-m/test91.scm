@@ -0,0 +1,25 @@
+(define out (open-output-file "/tmp/scheme-load-test.scm"))
+(write-string "(define square (lambda (x) (* x x)))" out)
+(newline out)
+(write-string "(define loaded 1)" out)
+(close-port out)
+
+(load "/tmp/scheme-load-test.scm")
+(square 12)
+loaded
+(set! loaded 5)
+(load "/tmp/scheme-load-test.scm")
+loaded
+
+(define out (open-output-file "/tmp/scheme-load-test.scm"))
+(write-string "(define square (lambda (x) (+ x x))) ; changed" out)
+(close-port out)
+(load "/tmp/scheme-load-test.scm")
+(square 12)
+(define out (open-output-file "/tmp/scheme-load-bad.scm"))
+(write-string "(define broken #q)" out)
+(close-port out)
+(spawn (lambda () (load "/tmp/scheme-load-bad.scm")))
+(yield)
+(square 5)
+(load "/tmp/scheme-no-such-file.scm")
@@ -0,0 +1,53 @@
+(define-syntax swap!
+  (syntax-rules ()
+    ((_ a b) (let ((tmp a)) (begin (set! a b) (set! b tmp))))))
+
+(define tmp 1)
+(define other 2)
+(swap! tmp other)
+tmp
+other
+
+(define-syntax my-or
+  (syntax-rules ()
+    ((_) #f)
+    ((_ e) e)
+    ((_ e r ...) (let ((t e)) (if t t (my-or r ...))))))
+
+(my-or)
+(my-or #f 7)
+(define t 5)
+(my-or #f t)
+
+(define-syntax my-let*
+  (syntax-rules ()
+    ((_ () body) body)
+    ((_ ((x v) rest ...) body) (let ((x v)) (my-let* (rest ...) body)))))
+
+(my-let* ((a 1) (b (+ a 1)) (c (* b 10))) (+ a b c))
+
+(define-syntax for-range
+  (syntax-rules (from to)
+    ((_ x from lo to hi body)
+     (letrec ((loop (lambda (x acc)
+                      (if (> x hi) acc (loop (+ x 1) (cons body acc))))))
+       (reverse (loop lo (quote ())))))))
+
+(for-range i from 1 to 5 (* i i))
+
+(define-syntax my-list
+  (syntax-rules ()
+    ((_ (a b) ...) (quote ((b a) ...)))))
+
+(my-list (1 2) (3 4) (5 6))
+(define square (lambda (n) (swap-free n)))
+(define-syntax swap-free
+  (syntax-rules ()
+    ((_ n) (* n n))))
+(define square (lambda (n) (swap-free n)))
+(square 9)
+(define-syntax tagged
+  (syntax-rules ()
+    ((_ v) (let ((tmp v)) (cons (quote tmp) tmp)))))
+(tagged 5)
+(my-let* 5)
@@ -0,0 +1,30 @@
+(define make-counter
+  (lambda (start)
+    (let ((count start))
+      (lambda () (begin (set! count (+ count 1)) count)))))
+(define counter (make-counter (car (cons 10 (quote (20))))))
+(counter)
+(counter)
+(define names (cons "ab" (cons (quote cd) (cons 1.5 (quote ((2 3)))))))
+(define p (delay (map (lambda (x) (* x x)) (quote (1 2 3)))))
+(define total 0)
+(set! total (fold + 0 (append (quote (1 2)) (quote (3 4)))))
+total
+names
+(force p)
+(force p)
+(define v (f64vector 1.0 2.0 3.0))
+(f64vector-sum v)
+(define-syntax swap!
+  (syntax-rules ()
+    ((_ a b) (let ((tmp a)) (begin (set! a b) (set! b tmp))))))
+(define x (reverse (quote (1 2))))
+(define y (reverse (quote (3 4))))
+(swap! x y)
+(cons x (cons y (quote ())))
+(define square (lambda (n) (* n n)))
+(letrec ((loop (lambda (i) (if (< i 100) (loop (+ i 1)) (square i))))) (loop 0))
+(define s (cons-stream 1 (stream-map (lambda (x) (* 2 x)) s)))
+(stream-take s 5)
+(stream-take s 6)
+(counter)
@@ -0,0 +1,15 @@
+(+)
+(+ 7)
+(+ 1 2)
+(+ 1 2.5)
+(+ 1 2 3 4)
+(* 6 7)
+(* 2 3.0 4)
+(append)
+(append (quote (1 2)) (quote (3)) (quote ()) (quote (4 5)))
+(map + (quote (1 2 3)) (quote (10 20 30)))
+(fold cons (quote ()) (quote (1 2 3)))
+(f64vector 1 2.5)
+(define add3 (lambda (a b c) (+ a b c)))
+(map add3 (quote (1 2)) (quote (3 4)) (quote (5 6)))
+(car (quote (1 2)) (quote (3 4)))
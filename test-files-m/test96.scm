@@ -0,0 +1,9 @@
+(define count (lambda (n) (if (= n 0) 0 (+ 1 (count (- n 1))))))
+(define build (lambda (n acc) (if (= n 0) acc (build (- n 1) (cons n acc)))))
+(with-limits ((steps 100000)) (count 100))
+(with-limits ((depth 200)) (count 150))
+(with-limits ((seconds 10) (bytes 10000000)) (length (build 1000 (quote ()))))
+(with-limits ((steps 100000)) (with-limits ((depth 1000)) (count 500)))
+(count 300)
+(with-limits ((depth 50)) (count 60))
+(count 1)
@@ -0,0 +1,12 @@
+(define table (quote ((apple 3 1.5 "red") (banana 12 0.25 "yellow") (cherry 200 0.1 "red") (empty ()) (flags #t #f))))
+(write-binary table "/tmp/scheme-binary-test.bin")
+(define loaded (load-binary "/tmp/scheme-binary-test.bin"))
+loaded
+(assoc (quote cherry) loaded)
+(length loaded)
+(map car loaded)
+(fold + 0 (map (lambda (row) (car (cdr row))) (filter (lambda (row) (= (length row) 4)) loaded)))
+(load-binary "/tmp/scheme-binary-test.bin")
+(write-binary 42 "/tmp/scheme-binary-test.bin")
+(+ (load-binary "/tmp/scheme-binary-test.bin") 1)
+(write-binary (cons 1 (cons (lambda (x) x) (quote ()))) "/tmp/scheme-binary-test.bin")
@@ -0,0 +1,27 @@
+(define add (lambda (a b) (+ a b)))
+(add 1 2)
+(add 3 4)
+(add 1.5 2.25)
+(add 1 2.5)
+(add 5 6)
+(define less (lambda (a b) (< a b)))
+(less 1.5 2.5)
+(less 2.5 1.5)
+(less 1 2)
+(define wrap (lambda (n) (+ n 1)))
+(wrap 2147483646)
+(wrap 2147483647)
+(define scale (lambda (x) (* x 3)))
+(scale 4)
+(scale 5)
+(define shadow (lambda (- a) (- a 1)))
+(shadow + 10)
+(define same (lambda (a b) (= a b)))
+(same 2 2)
+(same 2.0 2.0)
+(set! * +)
+(scale 5)
+(define < >)
+(less 1 2)
+(less 2.5 1.5)
+(add 7 8)
@@ -0,0 +1,28 @@
+(define square-server
+  (lambda ()
+    (let ((request (receive)))
+      (if (= (cdr request) -1)
+          (send (car request) (quote stopped))
+          (begin (send (car request) (* (cdr request) (cdr request)))
+                 (square-server))))))
+(define server (spawn-actor square-server))
+server
+(actor? server)
+(actor? (self))
+(actor? 5)
+(define ask
+  (lambda (n)
+    (begin (send server (cons (self) n))
+           (receive))))
+(ask 7)
+(map ask (quote (1 2 3 4.5)))
+(ask -1)
+(define total 100)
+(define echo (spawn-actor (lambda ()
+  (let ((message (receive)))
+    (begin (set! total (+ total 1))
+           (send (car message) (cons total (cdr message))))))))
+(send echo (cons (self) (cons "text" (cons (quote symbol) (cons #t (cons (list->f64vector (quote (1.5 2.5))) (quote ())))))))
+(receive)
+total
+(spawn-actor (lambda () (car (quote ()))))
@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include "linkedlist.h"
 #include "talloc.h"
+#include "source.h"
 #include <ctype.h>
 #include <string.h>
 
@@ -37,39 +38,141 @@ int isValid(char c) {
     }
 }
 
-// Read all of the input from stdin, and return a linked list consisting of the
-// tokens.
-Value *tokenize() {
+// Where the tokenizer reads characters from: a stdio stream, a port or text
+// in memory up to end. The line and column of the character last read are
+// followed as well, along with where the token last read started. The text of
+// the token being read is gathered in a buffer that grows to fit it.
+typedef struct {
+    FILE *stream;
+    Port *port;
+    char *text;
+    char *end;
+    int line;
+    int column;
+    int lastColumn;
+    int tokenLine;
+    int tokenColumn;
+    char *token;
+    size_t capacity;
+} Source;
+
+static char nextChar(Source *source) {
     char charRead;
-    Value *list = makeNull();
-    charRead = (char)fgetc(stdin);
+    if (source->text != NULL) {
+        charRead = source->text < source->end ? *source->text : EOF;
+        source->text++;
+    } else if (source->port != NULL) {
+        charRead = (char)portRead(source->port);
+    } else {
+        charRead = (char)fgetc(source->stream);
+    }
+    if (charRead == '\n') {
+        source->line++;
+        source->lastColumn = source->column;
+        source->column = 0;
+    } else {
+        source->column++;
+    }
+    return charRead;
+}
 
-    while (charRead != EOF) {
+// put back the character just read
+static void backChar(Source *source, char charRead) {
+    if (charRead == EOF) {
+        if (source->text != NULL) {
+            source->text--;
+        }
+        return;
+    }
+    if (charRead == '\n') {
+        source->line--;
+        source->column = source->lastColumn;
+    } else {
+        source->column--;
+    }
+    if (source->text != NULL) {
+        source->text--;
+    } else if (source->port != NULL) {
+        portUnread(source->port);
+    } else {
+        ungetc(charRead, source->stream);
+    }
+}
+
+// where a reader thread keeps its syntax error instead of printing it
+static __thread char **heldError;
+
+// Keep the message of a syntax error in *message rather than printing it, in
+// the calling thread; NULL goes back to printing.
+void holdSyntaxErrors(char **message) {
+    heldError = message;
+}
+
+// report a syntax error and end evaluation
+static void syntaxError(char *message) {
+    if (heldError != NULL) {
+        *heldError = message;
+    } else {
+        printf("%s\n", message);
+    }
+    texit(1);
+}
+
+// Put c at index in the text of the token being read. The buffer doubles when
+// it is full, so tokens of any length fit.
+static void putChar(Source *source, size_t index, char c) {
+    if (index >= source->capacity) {
+        size_t capacity = source->capacity ? source->capacity * 2 : 256;
+        char *token = talloc(capacity);
+        if (source->token != NULL) {
+            memcpy(token, source->token, source->capacity);
+        }
+        source->token = token;
+        source->capacity = capacity;
+    }
+    source->token[index] = c;
+}
 
+// a copy of the first length characters of the token being read
+static char *copyText(Source *source, size_t length) {
+    char *copy = talloc(length + 1);
+    memcpy(copy, source->token, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+// Read the next token from source, skipping whitespace and comments. Returns
+// NULL at the end of the input.
+static Value *nextToken(Source *source) {
+    char charRead = nextChar(source);
+
+    while (charRead != EOF) {
+        source->tokenLine = source->line;
+        source->tokenColumn = source->column;
         
         if (charRead == ';') { // anything after a ; on a line is ignored
-            while (charRead != '\n') {
-                charRead = (char)fgetc(stdin);
+            while (charRead != '\n' && charRead != EOF) {
+                charRead = nextChar(source);
             }
 
         } else if (charRead == '(') { //OPEN_TYPE
             Value *token = talloc(sizeof(Value));
             token->type = OPEN_TYPE;
             token->s = "("; //???? 
-            list = cons(token, list);
+            return token;
 
         } else if (charRead == ')') { //CLOSE_TYPE
             Value *token = talloc(sizeof(Value));
             token->type = CLOSE_TYPE;
             token->s = ")"; //????
-            list = cons(token, list);
+            return token;
 
 
         // take cares of numbers (integers and doubles) and plus/minus symbols
         } else if (isdigit(charRead) || charRead == '.' || 
         charRead == '-' || charRead == '+') { 
-            char buffer[301];
-            int isDouble = 0, index = 0;
+            int isDouble = 0;
+            size_t index = 0;
 
             // put all related chars into a string
             while (isdigit(charRead) || charRead == '.' || 
@@ -77,19 +180,20 @@ Value *tokenize() {
                 if (charRead == '.') {
                     isDouble = 1;
                 }
-                buffer[index] = charRead;
+                putChar(source, index, charRead);
                 index++;
-                charRead = (char)fgetc(stdin);
+                charRead = nextChar(source);
             }
-            buffer[index] = '\0';
+            putChar(source, index, '\0');
+            char *buffer = source->token;
 
             // create the token
             Value *token = talloc(sizeof(Value));
             char *ptr;
-            if (!strcmp(buffer, "+") || !strcmp(buffer, "-")) { //plus/minus symbols
+            if (!strcmp(buffer, "+") || !strcmp(buffer, "-") ||
+                !strcmp(buffer, "...")) { //plus/minus and ellipsis symbols
                 token->type = SYMBOL_TYPE;
-                token->s = talloc(2);
-                strcpy(token->s, buffer);
+                token->s = copyText(source, index);
             } else if (isDouble == 0) { // int
                 token->type = INT_TYPE;
                 token->i = strtol(buffer, &ptr, 10);
@@ -97,85 +201,139 @@ Value *tokenize() {
                 token->type = DOUBLE_TYPE;
                 token->d = strtod(buffer, &ptr);
             }
-            // insert
-            list = cons(token, list);
             // step back one char
-            ungetc(charRead, stdin);
+            backChar(source, charRead);
+            return token;
 
         
         // takes care of string
         } else if (charRead == '\"') { // strings
-            char currString[301];
-            int index = 0;
-            currString[index] = charRead; // put the first " in
-            charRead = (char)fgetc(stdin);
+            size_t index = 0;
+            putChar(source, index, charRead); // put the first " in
+            charRead = nextChar(source);
             index++;
             // put the entire string in
             while (charRead != '\"') {
-                currString[index] = charRead;
+                if (charRead == EOF) {
+                    syntaxError("Syntax error: unterminated string");
+                }
+                putChar(source, index, charRead);
                 index++;
-                charRead = (char)fgetc(stdin);
+                charRead = nextChar(source);
             }
             // set up the tail
-            currString[index] = '\"';
-            currString[index+1] = '\0';
+            putChar(source, index, '\"');
+            index++;
 
             Value *token = talloc(sizeof(Value));
             token->type = STR_TYPE;
-            token->s = talloc(301);
-            strcpy(token->s, currString);
-            list = cons(token, list);
+            token->s = copyText(source, index);
+            return token;
         
 
         // takes care of boolean
         } else if (charRead == '#') {
             Value *token = talloc(sizeof(Value));
             token->type = BOOL_TYPE;
-            charRead = (char)fgetc(stdin);
+            charRead = nextChar(source);
             if (charRead == 't') {
                 token->s = "#t";
             } else if (charRead == 'f') {
                 token->s = "#f";
             } else {
-                printf("Syntax error (readBoolean): boolean was not #t or #f\n");
-                texit(1);
+                syntaxError("Syntax error (readBoolean): boolean was not #t or #f");
             }
-            list = cons(token, list);
+            return token;
 
 
         // takes care of symbols other than +/-
         } else if (isInitial(charRead)) { 
             Value *token = talloc(sizeof(Value));
             token->type = SYMBOL_TYPE;
-            token->s = talloc(301);
             // read symbol into buffer
-            char buffer[301];
-            int index = 0;
+            size_t index = 0;
             while (isSubsequent(charRead)) {
-                buffer[index] = charRead;
+                putChar(source, index, charRead);
                 index++;
-                charRead = (char)fgetc(stdin);
+                charRead = nextChar(source);
             }
-            buffer[index] = '\0';
             // copy buffer string to token
-            strcpy(token->s, buffer);
-            list = cons(token, list);
+            token->s = copyText(source, index);
             // step back one char
-            ungetc(charRead, stdin);
+            backChar(source, charRead);
+            return token;
         
         // invalid symbols
         } else if (!isValid(charRead)) {
-            printf("Syntax error: invalid symbol\n");
-            texit(1);
+            syntaxError("Syntax error: invalid symbol");
         }
 
         // next char in file
-        charRead = (char)fgetc(stdin);
+        charRead = nextChar(source);
     }
+    return NULL;
+}
+
+
+// all the tokens of source, with positions recorded against name
+static Value *tokenizeSource(Source *source, char *name) {
+    int file = name != NULL && isTrackingPositions() ? sourceFile(name) : -1;
+    Value *list = makeNull();
+    Value *token;
+    while ((token = nextToken(source)) != NULL) {
+        if (file >= 0) {
+            setPosition(token, file, source->tokenLine, source->tokenColumn);
+        }
+        list = cons(token, list);
+    }
+    return reverse(list);
+}
+
+// Read all of the input from stream, and return a linked list consisting of
+// the tokens. While positions are tracked, each token's is recorded against
+// name (unless it is NULL).
+Value *tokenizeStream(FILE *stream, char *name) {
+    Source source = {stream, NULL, NULL, NULL, 1, 0, 0, 0, 0};
+    return tokenizeSource(&source, name);
+}
 
-    Value *revList = reverse(list);
-    return revList;
-};
+// Tokenize the length characters of text, as tokenizeStream does a stream.
+Value *tokenizeText(char *text, size_t length, char *name) {
+    Source source = {NULL, NULL, text, text + length, 1, 0, 0, 0, 0};
+    return tokenizeSource(&source, name);
+}
+
+
+// Read the tokens of the next datum from port: a single token, or everything
+// up to the parenthesis that closes the first one. Returns NULL at the end of
+// the input.
+Value *tokenizeDatum(Port *port) {
+    Source source = {NULL, port, NULL, NULL, 1, 0, 0, 0, 0};
+    Value *list = makeNull();
+    int depth = 0;
+    Value *token;
+    while ((token = nextToken(&source)) != NULL) {
+        list = cons(token, list);
+        if (token->type == OPEN_TYPE) {
+            depth++;
+        } else if (token->type == CLOSE_TYPE) {
+            depth--;
+        }
+        if (depth <= 0) {
+            break;
+        }
+    }
+    if (isNull(list)) {
+        return NULL;
+    }
+    return reverse(list);
+}
+
+// Read all of the input from stdin, and return a linked list consisting of the
+// tokens.
+Value *tokenize() {
+    return tokenizeStream(stdin, "<stdin>");
+}
 
 // Displays the contents of the linked list as tokens, with type information
 // Types are: boolean, integer!, double!, string, symbol, open!, close!
@@ -1,4 +1,6 @@
+#include <stdio.h>
 #include "value.h"
+#include "port.h"
 
 #ifndef _TOKENIZER
 #define _TOKENIZER
@@ -7,6 +9,24 @@
 // tokens.
 Value *tokenize();
 
+// Read all of the input from stream, and return a linked list consisting of
+// the tokens. While positions are tracked (see source.h), each token's is
+// recorded against the file called name, unless name is NULL.
+Value *tokenizeStream(FILE *stream, char *name);
+
+// Tokenize the length characters of text, as tokenizeStream does a stream.
+Value *tokenizeText(char *text, size_t length, char *name);
+
+// Keep the message of a syntax error in *message rather than printing it, in
+// the calling thread; NULL goes back to printing. The error still ends
+// evaluation through texit.
+void holdSyntaxErrors(char **message);
+
+// Read the tokens of the next datum from port: a single token, or everything
+// up to the parenthesis that closes the first one. Returns NULL at the end of
+// the input.
+Value *tokenizeDatum(Port *port);
+
 // Displays the contents of the linked list as tokens, with type information
 void displayTokens(Value *list);
 
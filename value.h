@@ -15,11 +15,29 @@ typedef enum {
     PRIMITIVE_TYPE,
 
     // Type below is new for final portion
-    UNSPECIFIED_TYPE
+    UNSPECIFIED_TYPE,
+
+    // Type below is for delay/force and streams
+    PROMISE_TYPE,
+
+    // Type below is for homogeneous vectors of doubles
+    F64VECTOR_TYPE,
+
+    // Types below are for file input and output
+    PORT_TYPE, EOF_TYPE,
+
+    // Type below is for define-syntax
+    MACRO_TYPE,
+
+    // Type below is for actors
+    ACTOR_TYPE
 } valueType;
 
 struct Value {
     valueType type;
+    // for a list in code, what eval has learned about it (see quicken.h);
+    // it fits in the padding after type, so cons cells stay compact
+    unsigned char quick;
     union {
         int i;
         double d;
@@ -33,21 +51,87 @@ struct Value {
         // containing everything needed to execute a user-defined function: (1)
         // a list of formal parameter names; (2) a pointer to the function body;
         // (3) a pointer to the environment frame in which the function was
-        // created.
+        // created. What it learns as it runs is kept right after it, in a
+        // ClosureInfo. The parameters are only checked, and the body only
+        // expanded, when the closure is first applied; functionCode is the
+        // rest of the lambda form, (body), so that the expansion can go back
+        // into the form.
         struct Closure {
             struct Value *paramNames;
             struct Value *functionCode;
             struct Frame *frame;
         } cl;
         
-        // A primitive style function; just a pointer to it, with the right
-        // signature (pf = primitive function)
-        struct Value *(*pf)(struct Value *);
+        // A promise holds an expression and the frame to evaluate it in until
+        // it is forced; after that it holds just the value, and code is NULL.
+        // Promises made by the stream primitives defer a call instead: code
+        // is a list of a function and its arguments, and frame is NULL.
+        struct Promise {
+            struct Value *value;
+            struct Value *code;
+            struct Frame *frame;
+        } pr;
+
+        // An f64vector keeps its doubles unboxed, side by side.
+        struct F64Vector {
+            double *elements;
+            int length;
+        } fv;
+
+        // A port is an open file with its buffer; see port.h.
+        struct Port *port;
+
+        // An actor is a thread with a mailbox; see actor.h.
+        struct Actor *actor;
+
+        // A macro made by syntax-rules: its literals and its list of
+        // (pattern template) rules.
+        struct Macro {
+            struct Value *literals;
+            struct Value *rules;
+        } mc;
+
+        // A primitive style function; a pointer to its entry in the table of
+        // primitives, which has its name, arity and C function
+        struct Primitive *primitive;
     };
 };
 
 typedef struct Value Value;
 
+// What a closure learns as it runs: how often it was called, how many
+// parameters it has once they were checked (-1 until its first call) and the
+// native code it was compiled to once it got hot. It follows the closure's
+// Value in memory instead of being in the union, so that other values don't
+// grow by it.
+typedef struct ClosureInfo {
+    int calls;
+    int arity;
+    struct Jit *native;
+} ClosureInfo;
+
+#define CLOSURE_SIZE (sizeof(Value) + sizeof(ClosureInfo))
+
+static inline ClosureInfo *closureInfo(Value *closure) {
+    return (ClosureInfo *)(closure + 1);
+}
+
+// Signature shared by all primitive functions: they get their arguments as
+// an array of argc values rather than as a list, so calling one allocates
+// nothing for them.
+typedef Value *(*PrimitiveFunction)(int argc, Value **argv);
+
+// A primitive function as it is registered: the name it is bound to, the
+// number of arguments it takes (-1 if it takes a varying number and checks
+// them itself), and optionally a version for exactly two arguments that is
+// picked instead of the general one for those calls.
+typedef struct Primitive {
+    char *name;
+    int arity;
+    PrimitiveFunction function;
+    PrimitiveFunction binary;
+} Primitive;
+
 
 // A frame is a linked list of bindings, and a pointer to another frame.  A
 // binding is a variable name (represented as a string), and a pointer to the